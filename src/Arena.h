@@ -0,0 +1,139 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+class Arena {
+    /*
+    Bump allocator for per-frame scratch memory (friend lists and the like).
+    allocate() only moves an offset forward, reset() throws everything away at once.
+    If a frame needed more than one chunk, reset() replaces them with a single chunk of
+    the combined size. Capacity never drops below that peak, and a frame that came within
+    a quarter of it gets a chunk of twice its use at the next reset, so a slowly growing
+    load (a flock getting denser) grows here, between frames, instead of overflowing mid-frame.
+    Not thread-safe: one arena per thread.
+    */
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+public:
+    explicit Arena(size_t chunkSize = 64 * 1024) : chunkSize(chunkSize) {}
+
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+
+        while (current < chunks.size()) {
+            size_t start = (offset + align - 1) & ~(align - 1);
+            if (start + bytes <= chunks[current].size) {
+                offset = start + bytes;
+                used += bytes;
+                return chunks[current].data.get() + start;
+            }
+            current++;
+            offset = 0;
+        }
+
+        size_t size = std::max(chunkSize, bytes + align);
+        if (!chunks.empty()) size = std::max(size, chunks.back().size * 2);
+        chunks.push_back({ std::unique_ptr<char[]>(new char[size]), size });
+        current = chunks.size() - 1;
+        offset = 0;
+        return allocate(bytes, align);
+    }
+
+    void reset() {
+        peak = std::max(peak, used);
+        size_t total = capacity();
+        size_t wanted = used > total - total / 4 ? std::max(total, used * 2) : total;
+        if (chunks.size() > 1 || wanted > total) {
+            chunks.clear();
+            chunks.push_back({ std::unique_ptr<char[]>(new char[wanted]), wanted });
+        }
+        current = 0;
+        offset = 0;
+        used = 0;
+    }
+
+    size_t bytesUsed() const { return used; }
+
+    // Most bytes any frame has used so far, the arena only grows when this does
+    size_t peakBytes() const { return std::max(peak, used); }
+
+    size_t capacity() const {
+        size_t total = 0;
+        for (const Chunk& c : chunks) total += c.size;
+        return total;
+    }
+
+private:
+    std::vector<Chunk> chunks;
+    size_t chunkSize;
+    size_t current = 0;
+    size_t offset = 0;
+    size_t used = 0;
+    size_t peak = 0;
+};
+
+template <typename T>
+class ScratchList {
+    /*
+    push_back-able list living in an Arena. Growing copies into a bigger block of the same
+    arena and leaves the old one behind until the arena is reset. Only valid until the next
+    reset of its arena, so reset(arena) has to be called before the list is filled again.
+    */
+    static_assert(std::is_trivially_copyable<T>::value, "ScratchList only holds trivially copyable types");
+
+public:
+    void reset(Arena* a) {
+        arena = a;
+        items = nullptr;
+        count = 0;
+        cap = 0;
+    }
+
+    // Keeps the memory, only valid within the same frame
+    void clear() { count = 0; }
+
+    void push_back(const T& value) {
+        if (count == cap) grow();
+        items[count++] = value;
+    }
+
+    void pop_back() { count--; }
+    T& back() { return items[count - 1]; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+
+private:
+    Arena* arena = nullptr;
+    T* items = nullptr;
+    uint32_t count = 0;
+    uint32_t cap = 0;
+
+    void grow() {
+        uint32_t newCap = cap ? cap * 2 : 16;
+        T* bigger = static_cast<T*>(arena->allocate(newCap * sizeof(T), alignof(T)));
+        if (count) std::memcpy(bigger, items, count * sizeof(T));
+        items = bigger;
+        cap = newCap;
+    }
+};
@@ -10,22 +10,11 @@ static thread_local std::mt19937 gen([] {
 }());
 std::uniform_real_distribution<float> steer(-1.0f, 1.0f);
 
-void Boid::update(
-
-    float alignmentStrength,
-    float cohesionStrength,
-    float separationStrength,
-    float aspect,
-    float deltaTime,
-    float minSpeed,
-    float maxSpeed,
-    glm::vec2 mousePoint, 
-    bool atract, 
-    bool repel,
-    bool bounce,
-    bool speedBasedColor
-
-    ) {
+void Boid::update(const BoidParams& params, glm::vec2 fieldForce) {
+
+		// Velocity changes cover steerTime (a multi-rate boid catching up on the steps it coasted),
+		// the position still moves by one deltaTime
+		float steerTime = params.steerTime > 0.0f ? params.steerTime : params.deltaTime;
 
 		glm::vec2 runAway(0.0f, 0.0f);
 		isPanicked = false;
@@ -53,15 +42,23 @@ void Boid::update(
 			blendedColor /= friends.size();
 
 			alignment /= (float)friends.size();
-			dir += alignment * alignmentStrength * deltaTime;
+			dir += alignment * params.alignment * steerTime;
 
 			cohesion /= (float)friends.size();
 			cohesion -= this->pos;
 
 			if (isPredator) cohesion *= 2.0f;
-			dir += cohesion * cohesionStrength * deltaTime;
+			dir += cohesion * params.cohesion * steerTime;
 
-			dir += sepeatation * separationStrength * deltaTime;
+			dir += sepeatation * params.separation * steerTime;
+		}
+
+		// Long range pull from the quadtree, weaker than the exact near-field rules
+		if (farCount > 0 && params.farFieldStrength > 0.0f) {
+
+			glm::vec2 farCohesion = farCenter - this->pos;
+			dir += farCohesion * params.cohesion * params.farFieldStrength * steerTime;
+			dir += farHeading * params.alignment * params.farFieldStrength * steerTime;
 		}
 
 		if (!predators.empty() && !isPredator) {
@@ -80,10 +77,10 @@ void Boid::update(
 		
 		}
 
-		dir += runAway * deltaTime;
+		dir += runAway * steerTime;
 
-		if (speedBasedColor && !isPredator) {
-			visColor = getSpeedColor(glm::length(dir), minSpeed, maxSpeed);
+		if (params.speedBasedColor && !isPredator) {
+			visColor = getSpeedColor(glm::length(dir), params.minSpeed, params.maxSpeed);
 		}
 		else if(!isPredator){
 		    if(!friends.empty()) this->color= glm::mix(this->color, blendedColor, 0.05f);
@@ -93,23 +90,37 @@ void Boid::update(
 			visColor = { 1.0f, 1.0f ,1.0f } ;
 		}
 
-		glm::vec2 steerForce(steer(gen), steer(gen));
+		// noiseSeed != 0 gives the same noise for the same boid id and step on any thread or process
+		glm::vec2 steerForce = params.noiseSeed ? seededSteer(params.noiseSeed) : glm::vec2(steer(gen), steer(gen));
 		dir += steerForce * 0.03f;
 
-		limitSpeed(minSpeed, maxSpeed);
+		limitSpeed(params.minSpeed, params.maxSpeed);
 
-		if (atract) {
-			addForce(5.3f, mousePoint, deltaTime);
+		if (params.atract) {
+			addForce(5.3f, params.mousePoint, params.mouseRadius, steerTime);
 		}
 	   
-		if (repel) {
-			addForce(-5.3f, mousePoint, deltaTime);
+		if (params.repel) {
+			addForce(-5.3f, params.mousePoint, params.mouseRadius, steerTime);
 		}
+
+		// Emitters of the force field, already summed and cut off by the Simulation
+		dir += fieldForce * steerTime;
     
-		this->pos += dir * deltaTime;
+		this->pos += dir * params.deltaTime;
 
-	    if(bounce) bounceBoundaries(aspect);
-	    handleBoundaries(aspect);
+	    if (params.bounce) bounceBoundaries(params.aspect);
+	    handleBoundaries(params.aspect);
+}
+
+void Boid::coast(float deltaTime, float aspect, bool bounce) {
+
+	// Straight-line extrapolation for steps a settled boid is not evaluated in
+	this->pos += dir * deltaTime;
+	coasted++;
+
+	if (bounce) bounceBoundaries(aspect);
+	handleBoundaries(aspect);
 }
 
 void Boid::handleBoundaries(float aspect) {
@@ -121,16 +132,17 @@ void Boid::handleBoundaries(float aspect) {
 	else if (this->pos.y < -1.1f) this->pos.y = 1.1f;
 }
 
-void Boid::addForce(float strength, glm::vec2 p, float deltaTime)
+void Boid::addForce(float strength, glm::vec2 p, float radius, float deltaTime)
 {
+	// Boids past the cutoff skip the square root and exp. The default cutoff is where exp(-2d)
+	// is down to 0.1% of its peak, so the profile is the same as without one.
 	glm::vec2 toMouse = p - this->pos;
-			float distance = glm::length(toMouse);
-
-	if (distance > 0.01f) {
-			float force = strength * exp(-distance * 2.0f);
-		dir += glm::normalize(toMouse) * force * deltaTime;
-	}
+	float distSq = glm::dot(toMouse, toMouse);
+	if (distSq >= radius * radius || distSq <= 0.0001f) return;
 
+	float distance = std::sqrt(distSq);
+	float force = strength * exp(-distance * 2.0f);
+	dir += toMouse / distance * force * deltaTime;
 }
 
 void Boid::bounceBoundaries(float aspect) {
@@ -154,7 +166,7 @@ void Boid::bounceBoundaries(float aspect) {
     }
 }
 
-void Boid::limitSpeed(float &minSpeed, float &maxSpeed) {
+void Boid::limitSpeed(float minSpeed, float maxSpeed) {
 
 	float currentSpeed = glm::length(dir);
 	if (currentSpeed > maxSpeed) {
@@ -187,6 +199,20 @@ float Boid::getRotation()
 	return atan2f(-normalD.y,normalD.x);
 }
 
+glm::vec2 Boid::seededSteer(unsigned int noiseSeed) const
+{
+	// Integer hash of (id, seed), two uniform values in [-1, 1)
+	unsigned int h = id * 0x9E3779B9u ^ noiseSeed;
+	glm::vec2 out;
+	for (int k = 0; k < 2; k++) {
+		h ^= h >> 16; h *= 0x7feb352du;
+		h ^= h >> 15; h *= 0x846ca68bu;
+		h ^= h >> 16;
+		out[k] = (h >> 8) * (2.0f / 16777216.0f) - 1.0f;
+	}
+	return out;
+}
+
 bool Boid::getFriend(Boid* potentialFriend, float fov, float fovRadius)
 {
 
@@ -213,3 +239,15 @@ bool Boid::getFriend(Boid* potentialFriend, float fov, float fovRadius)
 
 	return false;
 }
+
+bool Boid::sees(const Boid& other, float fov, float fovRadius) const
+{
+	// Same range and view cone test as getFriend, without touching the friend lists
+	if (&other == this) return false;
+
+	glm::vec2 toOther = other.pos - this->pos;
+	if (glm::dot(toOther, toOther) >= fovRadius * fovRadius) return false;
+	if (other.isPredator) return true;
+
+	return glm::dot(glm::normalize(dir), glm::normalize(-toOther)) <= fov * 0.5f;
+}
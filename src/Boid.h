@@ -1,6 +1,27 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <vector>
+#include "Arena.h"
+
+// Flock-wide settings of one Boid::update, by name so a new setting can't shift the others
+struct BoidParams {
+	float     alignment        = 2.0f;
+	float     cohesion         = 3.0f;
+	float     separation       = 1.0f;
+	float     aspect           = 1.0f;
+	float     deltaTime        = 0.016f;
+	float     steerTime        = 0.0f;   // time the steering forces act over, 0 = deltaTime
+	float     minSpeed         = 0.2f;
+	float     maxSpeed         = 0.5f;
+	glm::vec2 mousePoint       = { 0, 0 };
+	bool      atract           = false;
+	bool      repel            = false;
+	float     mouseRadius      = 3.45f;
+	bool      bounce           = true;
+	bool      speedBasedColor  = false;
+	float     farFieldStrength = 0.0f;
+	unsigned int noiseSeed     = 0;      // 0 = thread-local random noise
+};
 
 class Boid {
 public:
@@ -12,32 +33,51 @@ public:
 		bool ispred = false
 	) : pos(p), dir(d), color(c), isPredator(ispred) {};
 
+	unsigned int id = 0;   // stable identity, keys the reproducible steering noise
+
 	glm::vec2 pos;
 	glm::vec2 dir;
 	glm::vec3 color;
 	glm::vec3 blendedColor = { 0,0,0 };
 	glm::vec3 visColor = { 0, 0, 0 };
 
-	std::vector<Boid*> friends;
-	std::vector<Boid*> predators;
+	// Per-frame lists, backed by the per-thread arenas of the Simulation
+	ScratchList<Boid*> friends;
+	ScratchList<Boid*> predators;
+
+	// Far-field (quadtree) aggregate of boids beyond the fov radius
+	glm::vec2 farCenter  = { 0, 0 };
+	glm::vec2 farHeading = { 0, 0 };
+	int       farCount   = 0;
 	bool isPredator;
 	bool isPanicked = false;
 
-	void update(float aligmentStength, float cohesionStrength, float seperationStrength, float aspect,float deltaTime, float minSpeed, float maxSpeed, glm::vec2 mousePoint, bool atract, bool repel, bool bounce, bool speedBasedColor);
+	// Multi-rate state: evaluated every 2^rateLevel steps, coasting in between
+	int rateLevel     = 0;
+	int lastNeighbors = 0;
+	int coasted       = 0;   // steps coasted since the last evaluation
+
+	void update(const BoidParams& params, glm::vec2 fieldForce = glm::vec2(0.0f));
+
+	void coast(float deltaTime, float aspect, bool bounce);
 
 	void handleBoundaries(float aspect);
 
-	void addForce(float strength, glm::vec2 p, float deltaTime);
+	void addForce(float strength, glm::vec2 p, float radius, float deltaTime);
 
 	void bounceBoundaries(float aspect);
 
-	void limitSpeed(float& minSpeed, float& maxSpeed);
+	void limitSpeed(float minSpeed, float maxSpeed);
 
 	glm::vec3 getSpeedColor(float speed, float minSpeed, float maxSpeed);
 	
 	float getRotation();
 
+	glm::vec2 seededSteer(unsigned int noiseSeed) const;
+
 	bool getFriend(Boid* potentialFriend, float fov, float fovRadius);
 
+	bool sees(const Boid& other, float fov, float fovRadius) const;
+
 
 };
@@ -0,0 +1,214 @@
+#include "BoidsAPI.h"
+#include <new>
+#include <cmath>
+#include <omp.h>
+#include "Simulation.h"
+
+// Handle behind the C interface: one Simulation plus the host buffers its state goes to
+struct BoidsSim {
+	BoidsSim(uint32_t count, float aspect, uint32_t seed) : sim(count, aspect, seed) {
+		sim.mousePoint = { 0.0f, 0.0f };
+	}
+
+	Simulation sim;
+	int threads = 0;
+
+	float*    posX     = nullptr;
+	float*    posY     = nullptr;
+	float*    headingX = nullptr;
+	float*    headingY = nullptr;
+	uint32_t* ids      = nullptr;
+	size_t    capacity = 0;
+
+	BoidsStatus writeBuffers() {
+		int count = static_cast<int>(std::min(sim.Boids.size(), capacity));
+		const Boid* boids = sim.Boids.data();
+
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < count; i++) {
+			const Boid& b = boids[i];
+			if (posX)     posX[i] = b.pos.x;
+			if (posY)     posY[i] = b.pos.y;
+			if (headingX) headingX[i] = b.dir.x;
+			if (headingY) headingY[i] = b.dir.y;
+			if (ids)      ids[i] = b.id;
+		}
+		return sim.Boids.size() > capacity ? BOIDS_ERROR_CAPACITY : BOIDS_OK;
+	}
+};
+
+// Runs fn with this handle's thread count, exceptions don't cross the C boundary
+template <typename F>
+static BoidsStatus guarded(BoidsSim* handle, const F& fn) {
+	if (!handle) return BOIDS_ERROR_INVALID_HANDLE;
+
+	// The thread count is per host thread in OpenMP, so it is set around the call and put back
+	int previous = omp_get_max_threads();
+	if (handle->threads > 0) omp_set_num_threads(handle->threads);
+
+	BoidsStatus status;
+	try {
+		status = fn(*handle);
+	}
+	catch (...) {
+		status = BOIDS_ERROR_INTERNAL;
+	}
+
+	if (handle->threads > 0) omp_set_num_threads(previous);
+	return status;
+}
+
+extern "C" {
+
+uint32_t boids_api_version(void) {
+	return BOIDS_API_VERSION;
+}
+
+BoidsSim* boids_create(uint32_t count, float aspect, uint32_t seed) {
+	if (!(aspect > 0.0f)) return nullptr;
+	try {
+		return new BoidsSim(count, aspect, seed);
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void boids_destroy(BoidsSim* sim) {
+	delete sim;
+}
+
+BoidsStatus boids_step(BoidsSim* sim, float dt) {
+	if (!std::isfinite(dt) || dt < 0.0f) return sim ? BOIDS_ERROR_INVALID_ARGUMENT : BOIDS_ERROR_INVALID_HANDLE;
+	return guarded(sim, [dt](BoidsSim& h) {
+		h.sim.update(dt);
+		return h.writeBuffers();
+	});
+}
+
+BoidsStatus boids_set_param(BoidsSim* sim, BoidsParam param, float value) {
+	if (!sim) return BOIDS_ERROR_INVALID_HANDLE;
+	if (!std::isfinite(value)) return BOIDS_ERROR_INVALID_ARGUMENT;
+
+	Simulation& s = sim->sim;
+	switch (param) {
+	case BOIDS_PARAM_ASPECT:
+		if (value <= 0.0f) return BOIDS_ERROR_INVALID_ARGUMENT;
+		s.updateAspect(value);
+		break;
+	case BOIDS_PARAM_FOV:            s.fov = value; break;
+	case BOIDS_PARAM_FOV_RADIUS:
+		if (value <= 0.0f) return BOIDS_ERROR_INVALID_ARGUMENT;
+		s.fovRadius = value;
+		break;
+	case BOIDS_PARAM_ALIGNMENT:      s.alignment = value; break;
+	case BOIDS_PARAM_COHESION:       s.cohesion = value; break;
+	case BOIDS_PARAM_SEPARATION:     s.separation = value; break;
+	case BOIDS_PARAM_MIN_SPEED:
+		if (value < 0.0f || value > s.maxSpeed) return BOIDS_ERROR_INVALID_ARGUMENT;
+		s.minSpeed = value;
+		break;
+	case BOIDS_PARAM_MAX_SPEED:
+		if (value <= 0.0f || value < s.minSpeed) return BOIDS_ERROR_INVALID_ARGUMENT;
+		s.maxSpeed = value;
+		break;
+	case BOIDS_PARAM_BOUNCE:         s.bounce = value != 0.0f; break;
+	case BOIDS_PARAM_FAR_FIELD:      s.farField = value != 0.0f; break;
+	case BOIDS_PARAM_FAR_RADIUS:     s.farRadius = value; break;
+	case BOIDS_PARAM_FAR_STRENGTH:   s.farStrength = value; break;
+	case BOIDS_PARAM_TOPOLOGICAL:    s.topological = value != 0.0f; break;
+	case BOIDS_PARAM_TOPOLOGICAL_K:
+		if (value < 1.0f || value > BOIDS_MAX_TOPOLOGICAL_K) return BOIDS_ERROR_INVALID_ARGUMENT;
+		s.topologicalK = static_cast<int>(value);
+		break;
+	case BOIDS_PARAM_MULTI_RATE:     s.multiRate = value != 0.0f; break;
+	case BOIDS_PARAM_MAX_RATE_LEVEL:
+		if (value < 0.0f || value > BOIDS_MAX_RATE_LEVEL) return BOIDS_ERROR_INVALID_ARGUMENT;
+		s.maxRateLevel = static_cast<int>(value);
+		break;
+	case BOIDS_PARAM_MOUSE_RADIUS:
+		if (value <= 0.0f) return BOIDS_ERROR_INVALID_ARGUMENT;
+		s.mouseRadius = value;
+		break;
+	default:
+		return BOIDS_ERROR_UNKNOWN_PARAM;
+	}
+	return BOIDS_OK;
+}
+
+BoidsStatus boids_get_param(const BoidsSim* sim, BoidsParam param, float* value) {
+	if (!sim) return BOIDS_ERROR_INVALID_HANDLE;
+	if (!value) return BOIDS_ERROR_INVALID_ARGUMENT;
+
+	const Simulation& s = sim->sim;
+	switch (param) {
+	case BOIDS_PARAM_ASPECT:         *value = s.aspect; break;
+	case BOIDS_PARAM_FOV:            *value = s.fov; break;
+	case BOIDS_PARAM_FOV_RADIUS:     *value = s.fovRadius; break;
+	case BOIDS_PARAM_ALIGNMENT:      *value = s.alignment; break;
+	case BOIDS_PARAM_COHESION:       *value = s.cohesion; break;
+	case BOIDS_PARAM_SEPARATION:     *value = s.separation; break;
+	case BOIDS_PARAM_MIN_SPEED:      *value = s.minSpeed; break;
+	case BOIDS_PARAM_MAX_SPEED:      *value = s.maxSpeed; break;
+	case BOIDS_PARAM_BOUNCE:         *value = s.bounce ? 1.0f : 0.0f; break;
+	case BOIDS_PARAM_FAR_FIELD:      *value = s.farField ? 1.0f : 0.0f; break;
+	case BOIDS_PARAM_FAR_RADIUS:     *value = s.farRadius; break;
+	case BOIDS_PARAM_FAR_STRENGTH:   *value = s.farStrength; break;
+	case BOIDS_PARAM_TOPOLOGICAL:    *value = s.topological ? 1.0f : 0.0f; break;
+	case BOIDS_PARAM_TOPOLOGICAL_K:  *value = static_cast<float>(s.topologicalK); break;
+	case BOIDS_PARAM_MULTI_RATE:     *value = s.multiRate ? 1.0f : 0.0f; break;
+	case BOIDS_PARAM_MAX_RATE_LEVEL: *value = static_cast<float>(s.maxRateLevel); break;
+	case BOIDS_PARAM_MOUSE_RADIUS:   *value = s.mouseRadius; break;
+	default:
+		return BOIDS_ERROR_UNKNOWN_PARAM;
+	}
+	return BOIDS_OK;
+}
+
+BoidsStatus boids_set_threads(BoidsSim* sim, int threads) {
+	if (!sim) return BOIDS_ERROR_INVALID_HANDLE;
+	if (threads < 0) return BOIDS_ERROR_INVALID_ARGUMENT;
+	sim->threads = threads;
+	return BOIDS_OK;
+}
+
+BoidsStatus boids_set_attractor(BoidsSim* sim, BoidsAttractor mode, float x, float y) {
+	if (!sim) return BOIDS_ERROR_INVALID_HANDLE;
+	if (mode < BOIDS_ATTRACTOR_NONE || mode > BOIDS_ATTRACTOR_REPEL) return BOIDS_ERROR_INVALID_ARGUMENT;
+	sim->sim.mousePoint = { x, y };
+	sim->sim.atract = mode == BOIDS_ATTRACTOR_ATTRACT;
+	sim->sim.repel = mode == BOIDS_ATTRACTOR_REPEL;
+	return BOIDS_OK;
+}
+
+BoidsStatus boids_spawn(BoidsSim* sim, float x, float y, int count, int predator) {
+	if (!sim) return BOIDS_ERROR_INVALID_HANDLE;
+	if (count <= 0) return BOIDS_ERROR_INVALID_ARGUMENT;
+	// A full queue is drained by the next step, the host can retry after it
+	return sim->sim.commands.spawn({ x, y }, count, predator != 0) ? BOIDS_OK : BOIDS_ERROR_CAPACITY;
+}
+
+BoidsStatus boids_kill(BoidsSim* sim, float x, float y, float radius) {
+	if (!sim) return BOIDS_ERROR_INVALID_HANDLE;
+	if (!(radius > 0.0f)) return BOIDS_ERROR_INVALID_ARGUMENT;
+	return sim->sim.commands.kill({ x, y }, radius) ? BOIDS_OK : BOIDS_ERROR_CAPACITY;
+}
+
+BoidsStatus boids_bind_buffers(BoidsSim* sim, float* posX, float* posY, float* headingX, float* headingY,
+                               uint32_t* ids, size_t capacity) {
+	return guarded(sim, [&](BoidsSim& h) {
+		h.posX = posX;
+		h.posY = posY;
+		h.headingX = headingX;
+		h.headingY = headingY;
+		h.ids = ids;
+		h.capacity = capacity;
+		return h.writeBuffers();
+	});
+}
+
+size_t boids_count(const BoidsSim* sim) {
+	return sim ? sim->sim.Boids.size() : 0;
+}
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+/*
+C interface for embedding the flock in another application, built as the `boids` library
+with -DBOIDS_BUILD_LIBRARY=ON. Everything goes through an opaque handle, parameters are set
+by id so new ones can be added without breaking the ABI.
+
+State is written after every step straight into buffers the host owns (bound with
+boids_bind_buffers), as contiguous arrays of x, y positions and x, y headings, so the host
+reads it in place. Boid order changes when boids are killed, the optional id array keeps them apart.
+
+Threading: handles are independent, different handles may step at the same time from different
+host threads (each step runs its own OpenMP team, see boids_set_threads). One handle must not be
+stepped or configured from two threads at once, except boids_spawn/boids_kill which are queued
+lock-free and can be called from any thread, they take effect at the start of the next step.
+*/
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(BOIDS_SHARED)
+#  ifdef BOIDS_BUILDING
+#    define BOIDS_API __declspec(dllexport)
+#  else
+#    define BOIDS_API __declspec(dllimport)
+#  endif
+#elif defined(BOIDS_SHARED)
+#  define BOIDS_API __attribute__((visibility("default")))
+#else
+#  define BOIDS_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOIDS_API_VERSION 1
+
+/* Upper bounds of the integer parameters, larger values are rejected */
+#define BOIDS_MAX_TOPOLOGICAL_K 64
+#define BOIDS_MAX_RATE_LEVEL    8
+
+typedef struct BoidsSim BoidsSim;
+
+typedef enum BoidsStatus {
+    BOIDS_OK = 0,
+    BOIDS_ERROR_INVALID_HANDLE,
+    BOIDS_ERROR_INVALID_ARGUMENT,
+    BOIDS_ERROR_UNKNOWN_PARAM,
+    BOIDS_ERROR_CAPACITY,         /* the bound buffers were too small, only the first `capacity` boids were written */
+    BOIDS_ERROR_INTERNAL          /* allocation failure or another error inside the simulation */
+} BoidsStatus;
+
+/* Parameter ids, booleans are 0 / 1 */
+typedef enum BoidsParam {
+    BOIDS_PARAM_ASPECT = 0,       /* world is [-aspect, aspect] x [-1, 1] */
+    BOIDS_PARAM_FOV,
+    BOIDS_PARAM_FOV_RADIUS,       /* > 0 */
+    BOIDS_PARAM_ALIGNMENT,
+    BOIDS_PARAM_COHESION,
+    BOIDS_PARAM_SEPARATION,
+    BOIDS_PARAM_MIN_SPEED,        /* 0 <= min <= max, a value past the other bound is rejected: */
+    BOIDS_PARAM_MAX_SPEED,        /* raise max before min, lower min before max */
+    BOIDS_PARAM_BOUNCE,           /* 1 = bounce off the edges, 0 = wrap around */
+    BOIDS_PARAM_FAR_FIELD,
+    BOIDS_PARAM_FAR_RADIUS,
+    BOIDS_PARAM_FAR_STRENGTH,
+    BOIDS_PARAM_TOPOLOGICAL,
+    BOIDS_PARAM_TOPOLOGICAL_K,    /* 1 .. BOIDS_MAX_TOPOLOGICAL_K */
+    BOIDS_PARAM_MULTI_RATE,
+    BOIDS_PARAM_MAX_RATE_LEVEL,   /* 0 .. BOIDS_MAX_RATE_LEVEL, evaluated at least every 2^level steps */
+    BOIDS_PARAM_MOUSE_RADIUS,     /* > 0, the attractor has no effect beyond it (default 3.45) */
+    BOIDS_PARAM_COUNT
+} BoidsParam;
+
+typedef enum BoidsAttractor {
+    BOIDS_ATTRACTOR_NONE = 0,
+    BOIDS_ATTRACTOR_ATTRACT,
+    BOIDS_ATTRACTOR_REPEL
+} BoidsAttractor;
+
+BOIDS_API uint32_t boids_api_version(void);
+
+/* seed 0 = random start, anything else makes the run reproducible. Returns NULL on failure. */
+BOIDS_API BoidsSim* boids_create(uint32_t count, float aspect, uint32_t seed);
+BOIDS_API void boids_destroy(BoidsSim* sim);
+
+/* Advances by dt seconds and writes the new state into the bound buffers */
+BOIDS_API BoidsStatus boids_step(BoidsSim* sim, float dt);
+
+BOIDS_API BoidsStatus boids_set_param(BoidsSim* sim, BoidsParam param, float value);
+BOIDS_API BoidsStatus boids_get_param(const BoidsSim* sim, BoidsParam param, float* value);
+
+/* OpenMP threads used by this handle's steps, 0 = the OpenMP default */
+BOIDS_API BoidsStatus boids_set_threads(BoidsSim* sim, int threads);
+
+/* Pulls or pushes the flock towards a point like the mouse buttons of the app */
+BOIDS_API BoidsStatus boids_set_attractor(BoidsSim* sim, BoidsAttractor mode, float x, float y);
+
+BOIDS_API BoidsStatus boids_spawn(BoidsSim* sim, float x, float y, int count, int predator);
+BOIDS_API BoidsStatus boids_kill(BoidsSim* sim, float x, float y, float radius);
+
+/* Host-owned output arrays of `capacity` entries each, any of them may be NULL. They are filled
+   right away and after every step, until they are re-bound or the handle is destroyed. */
+BOIDS_API BoidsStatus boids_bind_buffers(BoidsSim* sim, float* posX, float* posY, float* headingX, float* headingY,
+                                         uint32_t* ids, size_t capacity);
+
+/* Boids alive after the last step (or since creation) */
+BOIDS_API size_t boids_count(const BoidsSim* sim);
+
+#ifdef __cplusplus
+}
+#endif
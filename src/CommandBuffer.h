@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+struct SimCommand {
+    enum Type : uint8_t { Spawn, Kill };
+
+    Type      type;
+    bool      predator;   // Spawn: spawn predators instead of regular boids
+    int       count;      // Spawn: how many boids
+    float     radius;     // Kill: every boid within radius of pos goes
+    glm::vec2 pos;
+};
+
+class CommandBuffer {
+    /*
+    Bounded lock-free multi-producer queue of spawn/kill requests.
+    Input callbacks (or any other thread) push commands, the simulation drains them all
+    between two steps, so nothing touches the boid vector while friend lists point into it.
+    Each slot carries a sequence number: producers claim a slot with a CAS on the tail and
+    publish it by bumping the sequence, the single consumer waits for exactly that sequence.
+    A full queue rejects the command instead of blocking the caller.
+    */
+    struct Slot {
+        std::atomic<size_t> sequence;
+        SimCommand command;
+    };
+
+public:
+    explicit CommandBuffer(size_t capacity = 1024) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        mask = size - 1;
+        slots = std::vector<Slot>(size);
+        for (size_t i = 0; i < size; i++) slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    CommandBuffer(const CommandBuffer&) = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+    bool spawn(glm::vec2 pos, int count, bool predator = false) {
+        return push({ SimCommand::Spawn, predator, count, 0.0f, pos });
+    }
+
+    bool kill(glm::vec2 pos, float radius) {
+        return push({ SimCommand::Kill, false, 0, radius, pos });
+    }
+
+    bool push(const SimCommand& command) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+
+        for (;;) {
+            Slot& slot = slots[pos & mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.command = command;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;   // full
+            }
+            else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    template <typename F>
+    size_t drain(const F& apply) {
+        // Single consumer: hands every published command to apply() in push order.
+        size_t drained = 0;
+
+        for (;;) {
+            Slot& slot = slots[head & mask];
+            if (slot.sequence.load(std::memory_order_acquire) != head + 1) break;
+
+            apply(slot.command);
+            slot.sequence.store(head + mask + 1, std::memory_order_release);
+            head++;
+            drained++;
+        }
+        return drained;
+    }
+
+    bool empty() const {
+        return slots[head & mask].sequence.load(std::memory_order_acquire) != head + 1;
+    }
+
+private:
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> tail{ 0 };
+    alignas(64) size_t head = 0;
+};
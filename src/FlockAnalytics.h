@@ -0,0 +1,185 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdio>
+#include <algorithm>
+#include <omp.h>
+#include <glm/glm.hpp>
+#include "Boid.h"
+#include "SpatialGrid.h"
+
+class FlockAnalytics {
+    /*
+    Flock health metrics computed from the friend lists and grid of the current step:
+    polarization (order parameter), flocks as connected components of the friend graph,
+    mean neighbor count and local density.
+    Components use a lock-free union-find: threads union the friend edges of their boids
+    concurrently, roots are linked towards the smaller index with a CAS and paths are
+    halved while searching. The whole pass is O(N + friend edges) and runs in parallel.
+    */
+public:
+    static const int sizeBins = 16;   // flock size histogram, bin b holds sizes [2^b, 2^(b+1))
+
+    struct Stats {
+        int    step           = 0;
+        int    boids          = 0;
+        float  polarization   = 0.0f;   // |mean unit heading|, 0 = disordered, 1 = aligned
+        int    flocks         = 0;      // components with at least minFlockSize boids
+        int    loners         = 0;      // boids in smaller components
+        int    largestFlock   = 0;
+        float  meanFlockSize  = 0.0f;
+        float  meanNeighbors  = 0.0f;   // neighbors per boid (undirected edges, or the k closest it follows)
+        float  localDensity   = 0.0f;   // boids per unit area around the average boid
+        int    sizeHistogram[sizeBins] = {};
+    };
+
+    int minFlockSize = 3;
+
+    // directed: every boid lists all of its own neighbors (topological mode), not one side of each pair
+    const Stats& compute(const std::vector<Boid>& boids, const SpatialGrid& grid, int step, bool directed = false) {
+
+        int numBoids = static_cast<int>(boids.size());
+        reserve(numBoids);
+        stats = Stats();
+        stats.step = step;
+        stats.boids = numBoids;
+        if (numBoids == 0) return stats;
+
+        const Boid* base = boids.data();
+        glm::vec2 heading(0.0f);
+        long long edges = 0;
+        float hx = 0.0f, hy = 0.0f;
+
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < numBoids; i++) parent[i].store(i, std::memory_order_relaxed);
+
+        // Metric friend lists only hold the higher-id side of each pair, so every edge is seen once.
+        // Topological lists are directed, a mutual pair shows up in both and is united twice.
+        #pragma omp parallel for schedule(dynamic, 256) reduction(+:edges, hx, hy)
+        for (int i = 0; i < numBoids; i++) {
+            const Boid& boid = boids[i];
+            float speed = glm::length(boid.dir);
+            if (speed > 0.0f) {
+                hx += boid.dir.x / speed;
+                hy += boid.dir.y / speed;
+            }
+
+            for (const Boid* other : boid.friends) {
+                unite(i, static_cast<int>(other - base));
+            }
+            edges += static_cast<long long>(boid.friends.size());
+        }
+        heading = { hx, hy };
+
+        // Component sizes, counted at the roots
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < numBoids; i++) componentSize[i].store(0, std::memory_order_relaxed);
+
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < numBoids; i++) {
+            componentSize[find(i)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        long long inFlocks = 0;
+        for (int i = 0; i < numBoids; i++) {
+            int size = componentSize[i].load(std::memory_order_relaxed);
+            if (size == 0) continue;
+
+            int bin = 0;
+            while ((2 << bin) <= size && bin < sizeBins - 1) bin++;
+            stats.sizeHistogram[bin]++;
+
+            if (size >= minFlockSize) {
+                stats.flocks++;
+                inFlocks += size;
+                stats.largestFlock = std::max(stats.largestFlock, size);
+            }
+            else {
+                stats.loners += size;
+            }
+        }
+
+        // Boid-weighted density: a boid in a cell of n sees n / cellArea around it
+        double weighted = 0.0;
+        for (const auto& cell : grid.cells()) {
+            double n = static_cast<double>(cell.second.size());
+            weighted += n * n;
+        }
+        float cellArea = grid.cellSize() * grid.cellSize();
+
+        stats.polarization  = glm::length(heading) / numBoids;
+        stats.meanFlockSize = stats.flocks ? static_cast<float>(inFlocks) / stats.flocks : 0.0f;
+        stats.meanNeighbors = (directed ? 1.0f : 2.0f) * static_cast<float>(edges) / numBoids;
+        stats.localDensity  = static_cast<float>(weighted / numBoids / cellArea);
+        return stats;
+    }
+
+    const Stats& latest() const {
+        return stats;
+    }
+
+    bool writeRow(const std::string& path) {
+        // Appends the latest stats to a CSV file, the header is written when the file is first opened
+        if (!file) {
+            file = std::fopen(path.c_str(), "w");
+            if (!file) return false;
+            std::fprintf(file, "step,boids,polarization,flocks,loners,largestFlock,meanFlockSize,meanNeighbors,localDensity");
+            for (int b = 0; b < sizeBins; b++) std::fprintf(file, ",size%d", 1 << b);
+            std::fprintf(file, "\n");
+        }
+
+        std::fprintf(file, "%d,%d,%.5f,%d,%d,%d,%.3f,%.3f,%.2f", stats.step, stats.boids, stats.polarization,
+            stats.flocks, stats.loners, stats.largestFlock, stats.meanFlockSize, stats.meanNeighbors, stats.localDensity);
+        for (int b = 0; b < sizeBins; b++) std::fprintf(file, ",%d", stats.sizeHistogram[b]);
+        std::fprintf(file, "\n");
+        std::fflush(file);
+        return true;
+    }
+
+    FlockAnalytics() = default;
+    FlockAnalytics(const FlockAnalytics&) = delete;
+    FlockAnalytics& operator=(const FlockAnalytics&) = delete;
+
+    ~FlockAnalytics() {
+        if (file) std::fclose(file);
+    }
+
+private:
+    std::unique_ptr<std::atomic<int>[]> parent;
+    std::unique_ptr<std::atomic<int>[]> componentSize;
+    int capacity = 0;
+    Stats stats;
+    std::FILE* file = nullptr;
+
+    void reserve(int numBoids) {
+        if (numBoids <= capacity) return;
+        capacity = std::max(numBoids, capacity * 2);
+        parent.reset(new std::atomic<int>[capacity]);
+        componentSize.reset(new std::atomic<int>[capacity]);
+    }
+
+    int find(int x) {
+        // Path halving, a lost CAS only means another thread already shortened the path
+        for (;;) {
+            int p = parent[x].load(std::memory_order_relaxed);
+            if (p == x) return x;
+            int gp = parent[p].load(std::memory_order_relaxed);
+            if (p != gp) parent[x].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+            x = gp;
+        }
+    }
+
+    void unite(int a, int b) {
+        for (;;) {
+            a = find(a);
+            b = find(b);
+            if (a == b) return;
+            if (a < b) std::swap(a, b);
+            // Only a root may be linked, if a stopped being one meanwhile try again
+            int expected = a;
+            if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) return;
+        }
+    }
+};
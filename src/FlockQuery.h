@@ -0,0 +1,161 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <omp.h>
+#include <glm/glm.hpp>
+#include "Boid.h"
+#include "SpatialGrid.h"
+
+// Results of a batched query: the hits of query i are ids[offsets[i] .. offsets[i+1]).
+// Keep one around and pass it again, its buffers are reused and a warm batch doesn't allocate.
+struct QueryBatch {
+    std::vector<int> offsets;
+    std::vector<int> ids;
+
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    const int* begin(size_t query) const { return ids.data() + offsets[query]; }
+    const int* end(size_t query) const { return ids.data() + offsets[query + 1]; }
+
+    // Scratch for the parallel run
+    std::vector<int> counts;
+    std::vector<std::vector<int>> threadIds;
+};
+
+class FlockQuery {
+    /*
+    Read-only spatial queries (radius, rectangle, k nearest) against the grid the Simulation
+    built for the current step. Results are boid indices into Simulation::Boids, tested
+    against the boids' current positions.
+    The grid was filled before the boids moved, so every query also looks at the cells within
+    `slack` (the furthest a boid can travel in one step) of its area. Boids that wrapped
+    around the world edge this step are only found once the next step rebuilt the grid.
+    All methods are const and safe to call from many threads as long as no step is running.
+    */
+    const SpatialGrid& grid;
+    const std::vector<Boid>& boids;
+    float slack;
+    float worldRadius;   // half diagonal of the wrapped world, bounds the kNN search
+
+public:
+    FlockQuery(const SpatialGrid& grid, const std::vector<Boid>& boids, float aspect, float slack)
+        : grid(grid), boids(boids), slack(slack),
+          worldRadius(std::sqrt((aspect + 0.1f) * (aspect + 0.1f) + 1.1f * 1.1f)) {}
+
+    void radius(glm::vec2 point, float r, std::vector<int>& out) const {
+        // Appends every boid within r of point.
+        float r2 = r * r;
+        forCells(point - glm::vec2(r), point + glm::vec2(r), [&](int id) {
+            glm::vec2 offset = boids[id].pos - point;
+            if (glm::dot(offset, offset) <= r2) out.push_back(id);
+        });
+    }
+
+    void rect(glm::vec2 lo, glm::vec2 hi, std::vector<int>& out) const {
+        // Appends every boid inside the axis-aligned rectangle [lo, hi].
+        forCells(lo, hi, [&](int id) {
+            glm::vec2 p = boids[id].pos;
+            if (p.x >= lo.x && p.x <= hi.x && p.y >= lo.y && p.y <= hi.y) out.push_back(id);
+        });
+    }
+
+    void nearest(glm::vec2 point, int k, std::vector<int>& out) const {
+        // Appends the k boids closest to point, nearest first (fewer if the flock is smaller).
+        if (k <= 0) return;
+
+        // Square search windows that double until k boids lie within the window's inscribed circle
+        thread_local std::vector<std::pair<float, int>> candidates;
+        float limit = glm::length(point) + 2.0f * worldRadius;
+        float r = std::max(grid.cellSize(), 1e-3f);
+
+        for (;;) {
+            candidates.clear();
+            forCells(point - glm::vec2(r), point + glm::vec2(r), [&](int id) {
+                glm::vec2 offset = boids[id].pos - point;
+                candidates.push_back({ glm::dot(offset, offset), id });
+            });
+
+            size_t inside = 0;
+            for (const auto& c : candidates) if (c.first <= r * r) inside++;
+            if (inside >= static_cast<size_t>(k) || r >= limit) break;
+            r *= 2.0f;
+        }
+
+        size_t count = std::min(candidates.size(), static_cast<size_t>(k));
+        std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end());
+        for (size_t i = 0; i < count; i++) out.push_back(candidates[i].second);
+    }
+
+    void radiusBatch(const std::vector<glm::vec2>& points, float r, QueryBatch& out) const {
+        batch(points.size(), out, [&](size_t i, std::vector<int>& ids) { radius(points[i], r, ids); });
+    }
+
+    void rectBatch(const std::vector<std::pair<glm::vec2, glm::vec2>>& rects, QueryBatch& out) const {
+        batch(rects.size(), out, [&](size_t i, std::vector<int>& ids) { rect(rects[i].first, rects[i].second, ids); });
+    }
+
+    void nearestBatch(const std::vector<glm::vec2>& points, int k, QueryBatch& out) const {
+        batch(points.size(), out, [&](size_t i, std::vector<int>& ids) { nearest(points[i], k, ids); });
+    }
+
+    template <typename F>
+    void batch(size_t count, QueryBatch& out, const F& query) const {
+        // Parallel over queries: every thread appends to its own buffer, then the buffers are
+        // laid out query by query. One team runs both loops with the same static schedule, so
+        // each thread copies back exactly the queries it ran, in order.
+        int numQueries = static_cast<int>(count);
+        size_t numThreads = static_cast<size_t>(omp_get_max_threads());
+        if (out.threadIds.size() < numThreads) out.threadIds.resize(numThreads);
+        out.counts.resize(count);
+        out.offsets.resize(count + 1);
+
+        #pragma omp parallel
+        {
+            std::vector<int>& local = out.threadIds[omp_get_thread_num()];
+            local.clear();
+
+            #pragma omp for schedule(static)
+            for (int i = 0; i < numQueries; i++) {
+                size_t before = local.size();
+                query(static_cast<size_t>(i), local);
+                out.counts[i] = static_cast<int>(local.size() - before);
+            }
+
+            // Implicit barriers after the loop and the single
+            #pragma omp single
+            {
+                out.offsets[0] = 0;
+                for (size_t i = 0; i < count; i++) out.offsets[i + 1] = out.offsets[i] + out.counts[i];
+                out.ids.resize(out.offsets[count]);
+            }
+
+            size_t read = 0;
+
+            #pragma omp for schedule(static)
+            for (int i = 0; i < numQueries; i++) {
+                std::copy(local.begin() + read, local.begin() + read + out.counts[i], out.ids.begin() + out.offsets[i]);
+                read += out.counts[i];
+            }
+        }
+    }
+
+private:
+    template <typename F>
+    void forCells(glm::vec2 lo, glm::vec2 hi, const F& visit) const {
+        // Calls visit(id) for every boid filed in a cell overlapping [lo, hi] grown by the slack.
+        auto low = grid.getCell(lo.x - slack, lo.y - slack);
+        auto high = grid.getCell(hi.x + slack, hi.y + slack);
+        int numBoids = static_cast<int>(boids.size());
+
+        for (int x = low.first; x <= high.first; x++) {
+            for (int y = low.second; y <= high.second; y++) {
+                const ScratchList<int>* cell = grid.findCell({ x, y });
+                if (!cell) continue;
+                for (int id : *cell) {
+                    if (id < numBoids) visit(id);
+                }
+            }
+        }
+    }
+};
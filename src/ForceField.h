@@ -0,0 +1,183 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+struct Emitter {
+    enum Type { Attractor, Repeller, Vortex };
+
+    Type      type     = Attractor;
+    glm::vec2 pos      = { 0, 0 };
+    float     strength = 1.0f;    // peak acceleration, vortices turn counter-clockwise when positive
+    float     radius   = 0.2f;    // no effect beyond this distance
+};
+
+class ForceField {
+    /*
+    Many attractors, repellers and vortices acting on the flock, binned into their own grid.
+    Every emitter is filed under each cell its cutoff disc touches, so a boid only reads the
+    emitters of the one cell it is in, and only those within their radius cost a square root.
+    The falloff is strength * (1 - d^2/r^2)^2, smooth and exactly zero at the cutoff.
+    The bins are rebuilt every step from `emitters` (O(emitters * cells they touch)), so emitters
+    can be moved or added freely between steps. Storage is reused, a steady step doesn't allocate.
+    */
+public:
+    std::vector<Emitter> emitters;
+
+    bool empty() const {
+        return emitters.empty();
+    }
+
+    void build(float aspect) {
+
+        // Boids wrap 0.1 past the edges, the grid covers that margin too
+        origin = { -aspect - 0.1f, -1.1f };
+        glm::vec2 extent = -2.0f * origin;
+
+        float meanRadius = 0.0f;
+        for (const Emitter& e : emitters) meanRadius += e.radius;
+        meanRadius /= std::max<size_t>(emitters.size(), 1);
+
+        // Cells half a mean radius wide (fewer candidates per boid than a full radius,
+        // for ~3x more bin entries), at most maxCells along an axis
+        cellSize = std::max(0.5f * meanRadius, std::max(extent.x, extent.y) / maxCells);
+        cols = std::max(1, static_cast<int>(std::ceil(extent.x / cellSize)));
+        rows = std::max(1, static_cast<int>(std::ceil(extent.y / cellSize)));
+
+        // Counting sort of (cell, emitter) pairs into CSR bins
+        cellStart.assign(static_cast<size_t>(cols) * rows + 1, 0);
+        forEachCoveredCell([&](int cell, size_t) { cellStart[cell + 1]++; });
+        for (size_t c = 1; c < cellStart.size(); c++) cellStart[c] += cellStart[c - 1];
+
+        binned.resize(cellStart.back());
+        fill.assign(cellStart.begin(), cellStart.end() - 1);
+        forEachCoveredCell([&](int cell, size_t index) {
+            const Emitter& e = emitters[index];
+            Packed& p = binned[fill[cell]++];
+            p.pos = e.pos;
+            p.radiusSq = e.radius * e.radius;
+            p.invRadiusSq = 1.0f / p.radiusSq;
+            p.strength = e.type == Emitter::Repeller ? -e.strength : e.strength;
+            p.vortex = e.type == Emitter::Vortex;
+        });
+    }
+
+    glm::vec2 force(glm::vec2 p) const {
+        // Sum of the emitters reaching p, valid after build()
+        glm::vec2 total(0.0f);
+        int cell = cellOf(p);
+        for (uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+            const Packed& e = binned[k];
+            glm::vec2 d = e.pos - p;
+            float distSq = glm::dot(d, d);
+            if (distSq >= e.radiusSq || distSq < 1e-8f) continue;
+
+            float t = 1.0f - distSq * e.invRadiusSq;
+            glm::vec2 unit = d / std::sqrt(distSq);
+            if (e.vortex) unit = { -unit.y, unit.x };
+            total += unit * (e.strength * t * t);
+        }
+        return total;
+    }
+
+    bool reaches(glm::vec2 p) const {
+        // Is p inside the range of any emitter
+        int cell = cellOf(p);
+        for (uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+            glm::vec2 d = binned[k].pos - p;
+            if (glm::dot(d, d) < binned[k].radiusSq) return true;
+        }
+        return false;
+    }
+
+    void scatter(int count, float aspect, unsigned int seed = 0) {
+        // Random mix of emitter types over the world, for demos and benchmarks
+        std::mt19937 gen(seed ? seed : std::random_device{}());
+        std::uniform_real_distribution<float> x(-aspect, aspect), y(-1.0f, 1.0f), unit(0.0f, 1.0f);
+        for (int i = 0; i < count; i++) {
+            Emitter e;
+            e.type = static_cast<Emitter::Type>(i % 3);
+            e.pos = { x(gen), y(gen) };
+            e.strength = 0.5f + 1.5f * unit(gen);
+            if (e.type == Emitter::Vortex && unit(gen) < 0.5f) e.strength = -e.strength;
+            e.radius = 0.03f + 0.07f * unit(gen);
+            emitters.push_back(e);
+        }
+    }
+
+    bool load(const std::string& path) {
+        // Scene file: one emitter per line, "attract|repel|vortex x y strength radius", # comments
+        std::ifstream file(path);
+        if (!file) return false;
+
+        std::string line;
+        while (std::getline(file, line)) {
+            size_t hash = line.find('#');
+            if (hash != std::string::npos) line.erase(hash);
+
+            std::istringstream in(line);
+            std::string type;
+            Emitter e;
+            if (!(in >> type)) continue;
+            if (!(in >> e.pos.x >> e.pos.y >> e.strength >> e.radius) || e.radius <= 0.0f) return false;
+
+            if (type == "attract") e.type = Emitter::Attractor;
+            else if (type == "repel") e.type = Emitter::Repeller;
+            else if (type == "vortex") e.type = Emitter::Vortex;
+            else return false;
+            emitters.push_back(e);
+        }
+        return true;
+    }
+
+private:
+    struct Packed {
+        glm::vec2 pos;
+        float     radiusSq;
+        float     invRadiusSq;
+        float     strength;    // negative for repellers
+        bool      vortex;
+    };
+
+    static const int maxCells = 256;
+
+    glm::vec2 origin = { 0, 0 };
+    float cellSize = 1.0f;
+    int cols = 1, rows = 1;
+    std::vector<uint32_t> cellStart = { 0, 0 };
+    std::vector<uint32_t> fill;
+    std::vector<Packed> binned;
+
+    int cellOf(glm::vec2 p) const {
+        int cx = std::min(std::max(static_cast<int>(std::floor((p.x - origin.x) / cellSize)), 0), cols - 1);
+        int cy = std::min(std::max(static_cast<int>(std::floor((p.y - origin.y) / cellSize)), 0), rows - 1);
+        return cy * cols + cx;
+    }
+
+    template <typename F>
+    void forEachCoveredCell(F&& visit) const {
+        for (size_t i = 0; i < emitters.size(); i++) {
+            const Emitter& e = emitters[i];
+            int x0 = std::max(static_cast<int>(std::floor((e.pos.x - e.radius - origin.x) / cellSize)), 0);
+            int x1 = std::min(static_cast<int>(std::floor((e.pos.x + e.radius - origin.x) / cellSize)), cols - 1);
+            int y0 = std::max(static_cast<int>(std::floor((e.pos.y - e.radius - origin.y) / cellSize)), 0);
+            int y1 = std::min(static_cast<int>(std::floor((e.pos.y + e.radius - origin.y) / cellSize)), rows - 1);
+
+            for (int cy = y0; cy <= y1; cy++) {
+                for (int cx = x0; cx <= x1; cx++) {
+                    // Skip the corners of the square the disc doesn't reach
+                    float nx = std::min(std::max(e.pos.x, origin.x + cx * cellSize), origin.x + (cx + 1) * cellSize);
+                    float ny = std::min(std::max(e.pos.y, origin.y + cy * cellSize), origin.y + (cy + 1) * cellSize);
+                    float dx = nx - e.pos.x, dy = ny - e.pos.y;
+                    if (dx * dx + dy * dy < e.radius * e.radius) visit(cy * cols + cx, i);
+                }
+            }
+        }
+    }
+};
@@ -8,16 +8,22 @@ extern GLFWwindow* window;
 extern GLuint SCR_WIDTH;
 extern GLuint SCR_HEIGHT;
 extern int spawnCount;
+extern float killRadius;
 extern bool spawnPredators;
 extern int FPS;
 extern int N;
 extern float scale;
+extern bool leanMode;
+extern LeanFlock lean;
+extern QualityController quality;
+extern RenderLod lod;
 
 class GUI {
 
 public:
 	ImGuiIO* io = nullptr;
 	ImGuiStyle style;
+	int emitterCount = 300;   // emitters added by one press of "Scatter emitters"
 
 	bool initializeImGUI() {
 
@@ -179,10 +185,60 @@ public:
 		ImGui::SliderFloat("Min Speed", &sim.minSpeed, 0.001f, 1.5f);
 		ImGui::SliderFloat("FOV range", &sim.fovRadius, 0.0f, 1.0f);
 		ImGui::SliderFloat("Scale", &scale, 0.001f, 3.0f);
+		ImGui::Checkbox("Far field (quadtree)", &sim.farField);
+		if (sim.farField) {
+			ImGui::SliderFloat("Far range", &sim.farRadius, sim.fovRadius, 2.0f);
+			ImGui::SliderFloat("Opening angle", &sim.theta, 0.1f, 1.5f);
+			ImGui::SliderFloat("Far weight", &sim.farStrength, 0.0f, 1.0f);
+		}
+		ImGui::Checkbox("Flock analytics", &sim.analytics);
+		if (sim.analytics) {
+			const FlockAnalytics::Stats& st = sim.flockStats.latest();
+			ImGui::SliderInt("Every N steps", &sim.analyticsInterval, 1, 300);
+			ImGui::Text("Polarization %.3f, neighbors %.1f, density %.0f", st.polarization, st.meanNeighbors, st.localDensity);
+			ImGui::Text("Flocks %d (largest %d, mean %.1f), loners %d", st.flocks, st.largestFlock, st.meanFlockSize, st.loners);
+		}
+		ImGui::Checkbox("Topological neighbors", &sim.topological);
+		if (sim.topological) {
+			ImGui::SliderInt("Neighbors (k)", &sim.topologicalK, 1, 32);
+		}
+		ImGui::Checkbox("Multi-rate integration", &sim.multiRate);
+		if (sim.multiRate) {
+			ImGui::SliderInt("Slowest rate (2^n steps)", &sim.maxRateLevel, 1, 3);
+			ImGui::SliderFloat("Settle angle", &sim.settleAngle, 0.01f, 0.5f);
+			ImGui::Text("Evaluated: %d of %d boids", sim.dueCount, (int)sim.Boids.size());
+		}
+		ImGui::Text("Force field: %zu emitters", sim.forceField.emitters.size());
+		ImGui::SliderInt("Emitters to add", &emitterCount, 1, 5000, "%d", ImGuiSliderFlags_Logarithmic);
+		if (ImGui::Button("Scatter emitters")) sim.forceField.scatter(emitterCount, sim.aspect);
+		ImGui::SameLine();
+		if (ImGui::Button("Clear emitters")) sim.forceField.emitters.clear();
+		ImGui::Checkbox("Work-stealing scheduler", &sim.useTaskScheduler);
+		ImGui::Checkbox("Incremental grid", &sim.incrementalGrid);
+		ImGui::Checkbox("NUMA-local placement", &sim.numaLocal);
+		if (sim.numaLocal) {
+			ImGui::SliderInt("Sort by cell every", &sim.reorderInterval, 1, 256);
+			ImGui::Text("%d bands, %d boids outside their band", sim.grid.bandCount(), sim.grid.strayCount());
+		}
 		ImGui::Checkbox("Bounce of edges", &sim.bounce);
-		ImGui::Checkbox("Friends making visualization", &sim.friendVisual);
+		ImGui::Checkbox("Neighbor inspector", &sim.friendVisual);
+		if (sim.friendVisual) {
+			const Simulation::Inspection& in = sim.inspection;
+			if (!in.selected) {
+				ImGui::Text("Ctrl + Left Click a boid to inspect it");
+			}
+			else {
+				ImGui::Text("Boid #%u: %d neighbors, %d predators, %d friends used this step", in.id, in.neighbors, in.predators, in.friendsUsed);
+				ImGui::Text("Alignment  %.3f", glm::length(in.alignment));
+				ImGui::Text("Cohesion   %.3f", glm::length(in.cohesion));
+				ImGui::Text("Separation %.3f", glm::length(in.separation));
+				ImGui::Text("Avoidance  %.3f", glm::length(in.avoidance));
+			}
+		}
 		ImGui::Checkbox("Color based on speed", &sim.speedCol);
-		ImGui::SliderInt("Spawning count", &spawnCount, 1, 20);
+		ImGui::SliderInt("Spawning count", &spawnCount, 1, 100000, "%d", ImGuiSliderFlags_Logarithmic);
+		ImGui::SliderFloat("Kill radius", &killRadius, 0.01f, 0.5f);
+		ImGui::SliderFloat("Mouse force radius", &sim.mouseRadius, 0.1f, 4.0f);
 		ImGui::Checkbox("Spawn predators", &spawnPredators);
 
 		ImGui::Separator();
@@ -190,10 +246,37 @@ public:
 		ImGui::Text("Left Click: Attract boids");
 		ImGui::Text("Right Click: Repel boids");
 		ImGui::Text("Middle Click: Generate boids");
+		ImGui::Text("Shift + Middle Click: Remove boids");
 
 		ImGui::Separator();
 		ImGui::Text("FPS: %d", FPS);
-		ImGui::Text("Boids: %d", N);
+		int lodChoice = lod.automatic ? 0 : lod.forced + 1;
+		const char* lodNames[] = { "Auto", "Triangles", "Points", "Density" };
+		if (ImGui::Combo("Render LOD", &lodChoice, lodNames, 4)) {
+			lod.automatic = lodChoice == 0;
+			if (lodChoice > 0) lod.forced = static_cast<RenderLod::Mode>(lodChoice - 1);
+		}
+		ImGui::Text("Drawing %s, %.1f px per boid, %.1fx overdraw", RenderLod::name(lod.mode), lod.boidPixels, lod.overdraw);
+		if (!leanMode) {
+			ImGui::Checkbox("Hold frame rate", &quality.enabled);
+			if (quality.enabled) {
+				ImGui::SliderFloat("Target FPS", &quality.targetFPS, 30.0f, 144.0f, "%.0f");
+				ImGui::Text("Sim %.2f ms, render %.2f ms, headroom %.2f ms of %.2f", quality.simMs, quality.renderMs, quality.headroom, quality.budgetMs());
+				ImGui::Text("Simulation: %s", quality.simDecision());
+				ImGui::Text("Drawing: %s", quality.drawDecision());
+			}
+		}
+		if (leanMode) {
+			LeanFlock::MemoryReport mem = lean.memoryReport();
+			ImGui::Text("Boids: %zu (lean mode)", lean.size());
+			ImGui::Text("Memory: %.1f MB, %.1f bytes/boid", mem.totalBytes / 1048576.0, mem.bytesPerBoid);
+			ImGui::SliderFloat("Lean FOV range", &lean.fovRadius, 0.001f, 0.1f);
+			ImGui::SliderInt("Lean neighbor cap", &lean.maxNeighbors, 1, 64);
+		}
+		else {
+			ImGui::Text("Boids: %d", N);
+		}
+		if (sim.incrementalGrid) ImGui::Text("Grid moves: %d", sim.gridMoved);
 
 		ImGui::End();
 
@@ -0,0 +1,462 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <omp.h>
+
+class LeanFlock {
+    /*
+    Memory-lean flock for very large populations (10M+ boids).
+    Boids have no identity and no heap storage of their own, the flock is a set of SoA arrays
+    kept sorted by grid cell:
+      - position: 16-bit fixed point x/y relative to the boid's cell (the cell is implied by the sort)
+      - heading: 8-bit angle, speed: 8-bit, color: 8-bit palette index
+    Every step reads the sorted arrays, writes the integrated boids to a second set together
+    with their new cell, then a counting sort brings them back in cell order.
+    Headings and speeds use stochastic rounding so small steering forces aren't lost to quantization.
+    Unlike Simulation there are no predators, and friends are capped at the maxNeighbors closest per boid.
+    */
+public:
+    struct MemoryReport {
+        size_t stateBytes   = 0;   // sorted boid arrays
+        size_t scratchBytes = 0;   // integration target + sort keys
+        size_t gridBytes    = 0;   // cell offsets and sort histograms
+        size_t totalBytes   = 0;
+        double bytesPerBoid = 0.0;
+    };
+
+    static constexpr int paletteSize = 16;
+
+    float aspect       = 1.0f;
+    float fov          = 0.5f;
+    float fovRadius    = 0.02f;
+    int   frameCount   = 0;
+
+    float alignment    = 2.0f;
+    float cohesion     = 3.0f;
+    float separation   = 1.0f;
+    float maxSpeed     = 0.5f;
+    float minSpeed     = 0.2f;
+    int   maxNeighbors = 16;
+
+    bool  atract       = false;
+    bool  repel        = false;
+    bool  bounce       = true;
+    glm::vec2 mousePoint = { 0.0f, 0.0f };
+    float mouseRadius = 3.45f;     // same cutoff as Simulation::mouseRadius
+
+    glm::vec3 palette[paletteSize];
+
+    void setup(size_t count, float aspectRatio, unsigned int seed = 0) {
+
+        aspect = aspectRatio;
+        numBoids = count;
+
+        for (int a = 0; a < 256; a++) {
+            float angle = a * angleStep;
+            cosLut[a] = std::cos(angle);
+            sinLut[a] = std::sin(angle);
+        }
+
+        std::mt19937 gen(seed ? seed : std::random_device{}());
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::uniform_real_distribution<float> gradient(0.0f, 0.5f);
+
+        // Same kind of saturated colors as Simulation::generateBoid, one of them per palette slot
+        for (int c = 0; c < paletteSize; c++) {
+            glm::vec3 color = { unit(gen), unit(gen), unit(gen) };
+            if (color.x > 0.8f) { color.y = gradient(gen); color.z = gradient(gen); }
+            if (color.y > 0.8f) { color.x = gradient(gen); color.z = gradient(gen); }
+            if (color.z > 0.8f) { color.y = gradient(gen); color.x = gradient(gen); }
+            palette[c] = color;
+        }
+
+        layout = computeLayout();
+        layoutAspect = aspect;
+        layoutRadius = fovRadius;
+        allocate();
+
+        std::uniform_real_distribution<float> posX(-aspect, aspect);
+        std::uniform_real_distribution<float> posY(-1.0f, 1.0f);
+        std::uniform_int_distribution<int> heading(0, 255);
+        std::uniform_int_distribution<int> color(0, paletteSize - 1);
+        std::uniform_real_distribution<float> speed(0.2f, 0.42f);
+
+        for (size_t i = 0; i < numBoids; i++) {
+            glm::vec2 pos = { posX(gen), posY(gen) };
+            uint32_t cell;
+            encodePosition(layout, pos, cell, next.fx[i], next.fy[i]);
+            nextCell[i] = cell;
+            next.heading[i] = static_cast<uint8_t>(heading(gen));
+            next.speed[i] = static_cast<uint8_t>(std::min(255.0f, speed(gen) / speedStep));
+            next.color[i] = static_cast<uint8_t>(color(gen));
+        }
+
+        sortByCell();
+    }
+
+    size_t size() const { return numBoids; }
+
+    void step(float dt) {
+
+        frameCount++;
+        if (aspect != layoutAspect || fovRadius != layoutRadius) relayout();
+
+        float radiusSq = fovRadius * fovRadius;
+        float halfFov = fov * 0.5f;
+        int numCells = layout.cols * layout.rows;
+
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (int c = 0; c < numCells; c++) {
+            int cx = c % layout.cols;
+            int cy = c / layout.cols;
+
+            for (uint32_t i = cellStart[c]; i < cellStart[c + 1]; i++) {
+                updateBoid(i, cx, cy, dt, radiusSq, halfFov);
+            }
+        }
+
+        sortByCell();
+    }
+
+    // Calls out(pos, rotation, color) for every stride-th boid of [first, last) in storage order
+    template <typename F>
+    void decodeRange(size_t first, size_t last, F&& out, size_t stride = 1) const {
+
+        if (first >= last) return;
+        int numCells = layout.cols * layout.rows;
+        int c = static_cast<int>(std::upper_bound(cellStart.begin(), cellStart.begin() + numCells + 1,
+                                                  static_cast<uint32_t>(first)) - cellStart.begin()) - 1;
+
+        for (size_t i = first; i < last; i += stride) {
+            while (i >= cellStart[c + 1]) c++;
+            glm::vec2 pos = decodePosition(layout, c % layout.cols, c / layout.cols, cur.fx[i], cur.fy[i]);
+            float rotation = -(cur.heading[i] * angleStep);
+            out(pos, rotation, palette[cur.color[i]]);
+        }
+    }
+
+    // Cell layout and occupancy, the density view draws straight from them
+    struct GridInfo {
+        glm::vec2 origin;
+        float cellSize;
+        int cols, rows;
+    };
+
+    GridInfo gridInfo() const {
+        return { { layout.originX, layout.originY }, layout.cellSize, layout.cols, layout.rows };
+    }
+
+    uint32_t cellCount(int cx, int cy) const {
+        size_t c = static_cast<size_t>(cy) * layout.cols + cx;
+        return cellStart[c + 1] - cellStart[c];
+    }
+
+    MemoryReport memoryReport() const {
+        MemoryReport report;
+        report.stateBytes = cur.bytes();
+        report.scratchBytes = next.bytes() + nextCell.capacity() * sizeof(uint32_t);
+        report.gridBytes = (cellStart.capacity() + histogram.capacity()) * sizeof(uint32_t);
+        report.totalBytes = report.stateBytes + report.scratchBytes + report.gridBytes + sizeof(*this);
+        report.bytesPerBoid = numBoids ? (double)report.totalBytes / numBoids : 0.0;
+        return report;
+    }
+
+private:
+    struct State {
+        std::vector<uint16_t> fx, fy;
+        std::vector<uint8_t> heading, speed, color;
+
+        void resize(size_t n) {
+            fx.resize(n); fy.resize(n);
+            heading.resize(n); speed.resize(n); color.resize(n);
+        }
+
+        size_t bytes() const {
+            return (fx.capacity() + fy.capacity()) * sizeof(uint16_t)
+                + heading.capacity() + speed.capacity() + color.capacity();
+        }
+    };
+
+    struct Layout {
+        float originX, originY, cellSize;
+        int cols, rows;
+    };
+
+    static constexpr float angleStep = 6.28318530718f / 256.0f;
+    static constexpr float speedStep = 1.5f / 255.0f;      // covers the whole Max Speed slider
+    static constexpr int   maxCells  = 1 << 22;
+    static constexpr int   maxNeighborCap = 64;   // top of the "Lean neighbor cap" slider
+
+    struct Neighbor {
+        float distSq;
+        uint32_t index;
+        glm::vec2 toFriend;
+    };
+
+    State cur, next;
+    std::vector<uint32_t> nextCell;
+    std::vector<uint32_t> cellStart;    // cols*rows + 1 offsets into cur
+    std::vector<uint32_t> histogram;    // per-thread cell counts for the counting sort
+    Layout layout{};
+    float layoutAspect = 0.0f, layoutRadius = 0.0f;
+    float cosLut[256], sinLut[256];
+    size_t numBoids = 0;
+
+    Layout computeLayout() const {
+        // Boids wrap 0.1 past the edges, the grid has to cover that margin too
+        Layout l;
+        float halfWidth = aspect + 0.1f;
+        float halfHeight = 1.1f;
+        l.cellSize = std::max(fovRadius, 0.001f);
+        while ((2.0f * halfWidth / l.cellSize + 1.0f) * (2.0f * halfHeight / l.cellSize + 1.0f) > maxCells) l.cellSize *= 1.5f;
+        l.originX = -halfWidth;
+        l.originY = -halfHeight;
+        l.cols = static_cast<int>(std::ceil(2.0f * halfWidth / l.cellSize));
+        l.rows = static_cast<int>(std::ceil(2.0f * halfHeight / l.cellSize));
+        return l;
+    }
+
+    void allocate() {
+        cur.resize(numBoids);
+        next.resize(numBoids);
+        nextCell.resize(numBoids);
+        cellStart.assign(static_cast<size_t>(layout.cols) * layout.rows + 1, 0);
+    }
+
+    static void encodePosition(const Layout& l, glm::vec2 pos, uint32_t& cell, uint16_t& fx, uint16_t& fy) {
+        float gx = (pos.x - l.originX) / l.cellSize;
+        float gy = (pos.y - l.originY) / l.cellSize;
+        int cx = std::min(std::max(static_cast<int>(std::floor(gx)), 0), l.cols - 1);
+        int cy = std::min(std::max(static_cast<int>(std::floor(gy)), 0), l.rows - 1);
+        cell = static_cast<uint32_t>(cy * l.cols + cx);
+        fx = static_cast<uint16_t>(std::min(std::max((gx - cx) * 65536.0f, 0.0f), 65535.0f));
+        fy = static_cast<uint16_t>(std::min(std::max((gy - cy) * 65536.0f, 0.0f), 65535.0f));
+    }
+
+    static glm::vec2 decodePosition(const Layout& l, int cx, int cy, uint16_t fx, uint16_t fy) {
+        return { l.originX + (cx + fx * (1.0f / 65536.0f)) * l.cellSize,
+                 l.originY + (cy + fy * (1.0f / 65536.0f)) * l.cellSize };
+    }
+
+    float cellDistanceSq(int cx, int cy, glm::vec2 p) const {
+        // Squared distance from p to the closest point of cell (cx, cy)
+        float minX = layout.originX + cx * layout.cellSize;
+        float minY = layout.originY + cy * layout.cellSize;
+        float dx = std::max(std::max(minX - p.x, p.x - (minX + layout.cellSize)), 0.0f);
+        float dy = std::max(std::max(minY - p.y, p.y - (minY + layout.cellSize)), 0.0f);
+        return dx * dx + dy * dy;
+    }
+
+    static uint32_t hash(uint32_t x) {
+        x ^= x >> 16; x *= 0x7feb352dU;
+        x ^= x >> 15; x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return x;
+    }
+
+    static float unitFloat(uint32_t h) {
+        return (h >> 8) * (1.0f / 16777216.0f);
+    }
+
+    void updateBoid(uint32_t i, int cx, int cy, float dt, float radiusSq, float halfFov) {
+
+        glm::vec2 pos = decodePosition(layout, cx, cy, cur.fx[i], cur.fy[i]);
+        glm::vec2 heading = { cosLut[cur.heading[i]], sinLut[cur.heading[i]] };
+        glm::vec2 dir = heading * (cur.speed[i] * speedStep);
+
+        // Bounded max-heap of the k closest visible neighbors, like Simulation::closestFriends: the
+        // home cell goes first, then a neighboring cell is skipped once it lies further away than
+        // the current k-th. Taking the first k found instead would favor the cells scanned first.
+        Neighbor closest[maxNeighborCap];
+        int k = std::min(std::max(maxNeighbors, 1), maxNeighborCap);
+        int found = 0;
+        auto further = [](const Neighbor& a, const Neighbor& b) { return a.distSq < b.distSq; };
+
+        for (int c = 0; c < 9; c++) {
+            // c == 0 is the home cell, 1..8 its neighbors
+            int nx = cx + (c == 0 ? 0 : (c <= 4 ? c - 1 : c) % 3 - 1);
+            int ny = cy + (c == 0 ? 0 : (c <= 4 ? c - 1 : c) / 3 - 1);
+            if (nx < 0 || ny < 0 || nx >= layout.cols || ny >= layout.rows) continue;
+
+            if (c > 0) {
+                float limit = found == k ? closest[0].distSq : radiusSq;
+                if (cellDistanceSq(nx, ny, pos) >= limit) continue;
+            }
+            int nc = ny * layout.cols + nx;
+
+            for (uint32_t j = cellStart[nc]; j < cellStart[nc + 1]; j++) {
+                if (j == i) continue;
+
+                glm::vec2 toFriend = decodePosition(layout, nx, ny, cur.fx[j], cur.fy[j]) - pos;
+                float distSq = glm::dot(toFriend, toFriend);
+                if (distSq >= radiusSq || distSq <= 0.0f) continue;
+                if (found == k && distSq >= closest[0].distSq) continue;
+
+                // Same field of view test as Boid::getFriend
+                float cosVal = glm::dot(heading, -toFriend / std::sqrt(distSq));
+                if (cosVal > halfFov) continue;
+
+                if (found == k) std::pop_heap(closest, closest + found--, further);
+                closest[found++] = { distSq, j, toFriend };
+                std::push_heap(closest, closest + found, further);
+            }
+        }
+
+        glm::vec2 alignmentSum(0.0f), cohesionSum(0.0f), separationSum(0.0f);
+        uint8_t colorVotes[paletteSize] = {};
+        int friends = found;
+
+        for (int f = 0; f < found; f++) {
+            uint32_t j = closest[f].index;
+            alignmentSum += glm::vec2(cosLut[cur.heading[j]], sinLut[cur.heading[j]]);
+            cohesionSum += pos + closest[f].toFriend;
+            // Same weighting as Boid::update
+            separationSum += -closest[f].toFriend / (2.0f + 0.000001f);
+            colorVotes[cur.color[j]]++;
+        }
+
+        uint32_t seed = hash(i * 0x9E3779B9U ^ hash(static_cast<uint32_t>(frameCount)));
+        uint32_t r0 = hash(seed), r1 = hash(r0), r2 = hash(r1), r3 = hash(r2), r4 = hash(r3);
+
+        uint8_t color = cur.color[i];
+
+        if (friends > 0) {
+            float inv = 1.0f / friends;
+            dir += alignmentSum * inv * alignment * dt;
+            dir += (cohesionSum * inv - pos) * cohesion * dt;
+            dir += separationSum * separation * dt;
+
+            // Palette stand-in for the color blending: sometimes adopt the local majority
+            int best = 0;
+            for (int c = 1; c < paletteSize; c++) if (colorVotes[c] > colorVotes[best]) best = c;
+            if (colorVotes[best] * 2 > friends && unitFloat(r4) < 0.05f) color = static_cast<uint8_t>(best);
+        }
+
+        dir += glm::vec2(unitFloat(r0) * 2.0f - 1.0f, unitFloat(r1) * 2.0f - 1.0f) * 0.03f;
+
+        float speed = glm::length(dir);
+        if (speed <= 0.0f) {
+            dir = heading * minSpeed;
+            speed = minSpeed;
+        }
+        else if (speed > maxSpeed) {
+            dir *= maxSpeed / speed;
+            speed = maxSpeed;
+        }
+        else if (speed < minSpeed) {
+            dir *= minSpeed / speed;
+            speed = minSpeed;
+        }
+
+        if (atract || repel) {
+            // Same cutoff as Boid::addForce
+            glm::vec2 toMouse = mousePoint - pos;
+            float distSq = glm::dot(toMouse, toMouse);
+            if (distSq < mouseRadius * mouseRadius && distSq > 0.0001f) {
+                float distance = std::sqrt(distSq);
+                float force = (atract ? 5.3f : -5.3f) * std::exp(-distance * 2.0f);
+                dir += toMouse / distance * force * dt;
+                speed = glm::length(dir);
+            }
+        }
+
+        pos += dir * dt;
+
+        if (bounce) {
+            if (pos.x >= aspect) { pos.x = aspect; dir.x *= -1.0f; }
+            else if (pos.x <= -aspect) { pos.x = -aspect; dir.x *= -1.0f; }
+            if (pos.y >= 1.0f) { pos.y = 1.0f; dir.y *= -1.0f; }
+            else if (pos.y <= -1.0f) { pos.y = -1.0f; dir.y *= -1.0f; }
+        }
+
+        if (pos.x > aspect + 0.1f) pos.x = -aspect - 0.1f;
+        else if (pos.x < -aspect - 0.1f) pos.x = aspect + 0.1f;
+        if (pos.y > 1.1f) pos.y = -1.1f;
+        else if (pos.y < -1.1f) pos.y = 1.1f;
+
+        // Stochastic rounding, keeps the expected heading/speed exact
+        float angle = std::atan2(dir.y, dir.x) / angleStep;
+        int quantAngle = static_cast<int>(std::floor(angle + unitFloat(r2))) & 255;
+        float quantSpeed = std::floor(speed / speedStep + unitFloat(r3));
+
+        encodePosition(layout, pos, nextCell[i], next.fx[i], next.fy[i]);
+        next.heading[i] = static_cast<uint8_t>(quantAngle);
+        next.speed[i] = static_cast<uint8_t>(std::min(quantSpeed, 255.0f));
+        next.color[i] = color;
+    }
+
+    void sortByCell() {
+        // Parallel counting sort of 'next' into 'cur' by nextCell, stable within each thread's chunk
+        size_t numCells = static_cast<size_t>(layout.cols) * layout.rows;
+        size_t n = numBoids;
+
+        // One histogram per thread of this sort's team, the thread count may have changed since the last one
+        int team = omp_get_max_threads();
+        if (histogram.size() < static_cast<size_t>(team) * numCells) histogram.resize(static_cast<size_t>(team) * numCells);
+
+        #pragma omp parallel num_threads(team)
+        {
+            size_t threads = static_cast<size_t>(omp_get_num_threads());
+            size_t t = static_cast<size_t>(omp_get_thread_num());
+            size_t chunk = (n + threads - 1) / threads;
+            size_t begin = std::min(n, t * chunk);
+            size_t end = std::min(n, begin + chunk);
+            uint32_t* counts = histogram.data() + t * numCells;
+
+            std::fill(counts, counts + numCells, 0u);
+            for (size_t i = begin; i < end; i++) counts[nextCell[i]]++;
+
+            #pragma omp barrier
+            #pragma omp single
+            {
+                uint32_t running = 0;
+                for (size_t c = 0; c < numCells; c++) {
+                    cellStart[c] = running;
+                    for (size_t k = 0; k < threads; k++) {
+                        uint32_t count = histogram[k * numCells + c];
+                        histogram[k * numCells + c] = running;
+                        running += count;
+                    }
+                }
+                cellStart[numCells] = running;
+            }
+
+            for (size_t i = begin; i < end; i++) {
+                uint32_t dst = counts[nextCell[i]]++;
+                cur.fx[dst] = next.fx[i];
+                cur.fy[dst] = next.fy[i];
+                cur.heading[dst] = next.heading[i];
+                cur.speed[dst] = next.speed[i];
+                cur.color[dst] = next.color[i];
+            }
+        }
+    }
+
+    void relayout() {
+        // Aspect or radius changed: re-encode every boid against the new grid
+        Layout old = layout;
+        std::vector<uint32_t> oldStart = cellStart;
+
+        layout = computeLayout();
+        layoutAspect = aspect;
+        layoutRadius = fovRadius;
+
+        int oldCells = old.cols * old.rows;
+        for (int c = 0; c < oldCells; c++) {
+            for (uint32_t i = oldStart[c]; i < oldStart[c + 1]; i++) {
+                glm::vec2 pos = decodePosition(old, c % old.cols, c / old.cols, cur.fx[i], cur.fy[i]);
+                encodePosition(layout, pos, nextCell[i], next.fx[i], next.fy[i]);
+                next.heading[i] = cur.heading[i];
+                next.speed[i] = cur.speed[i];
+                next.color[i] = cur.color[i];
+            }
+        }
+
+        cellStart.assign(static_cast<size_t>(layout.cols) * layout.rows + 1, 0);
+        sortByCell();
+    }
+};
@@ -0,0 +1,180 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+// Helpers for multi-socket hosts. Linux hands out a page on the node of the thread that writes it
+// first, so data is only local to the threads that work on it if those same threads touch it first,
+// and only stays local if the threads don't wander to another socket afterwards (pinning).
+// Everything here degrades to a no-op on single-node machines and outside Linux.
+namespace numa {
+
+	// Contiguous part of [0, n) that schedule(static) gives to thread `part` of `parts`
+	// (the first n % parts threads get one extra iteration, like libgomp and the LLVM runtime do)
+	struct Block { int begin, end; };
+
+	inline Block staticBlock(int n, int parts, int part) {
+		int base = n / parts, extra = n % parts;
+		int begin = part * base + std::min(part, extra);
+		return { begin, begin + base + (part < extra ? 1 : 0) };
+	}
+
+	// Writes one byte per page of [data, data + count) with the same static partition as the
+	// simulation loops, so every page lands on the node of the thread that will update it.
+	// For fresh storage that nothing has written yet (right after reserve()).
+	template <typename T>
+	void firstTouch(T* data, size_t count) {
+		const uintptr_t page = 4096;
+		uintptr_t base = reinterpret_cast<uintptr_t>(data);
+		int n = static_cast<int>(count);
+
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < n; i++) {
+			uintptr_t begin = base + static_cast<uintptr_t>(i) * sizeof(T);
+			uintptr_t end = begin + sizeof(T);
+			// Element i owns the pages that start inside it, element 0 also the one it starts in
+			uintptr_t p = i == 0 ? begin : (begin + page - 1) & ~(page - 1);
+			for (; p < end; p = (p & ~(page - 1)) + page) *reinterpret_cast<volatile char*>(p) = 0;
+		}
+	}
+
+	// reserve() that moves the elements into freshly first-touched storage
+	template <typename T>
+	void reserveLocal(std::vector<T>& v, size_t capacity) {
+		std::vector<T> fresh;
+		fresh.reserve(std::max(capacity, v.size()));
+		firstTouch(fresh.data(), fresh.capacity());
+		fresh.insert(fresh.end(), std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()));
+		v.swap(fresh);
+	}
+
+	inline std::vector<int> parseCpuList(const std::string& list) {
+		// "0-3,8,10-11" as used by /sys and taskset
+		std::vector<int> cpus;
+		std::stringstream in(list);
+		std::string range;
+		while (std::getline(in, range, ',')) {
+			int first = 0, last = 0;
+			int fields = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+			if (fields < 1 || first < 0) return {};
+			if (fields == 1) last = first;
+			for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+		}
+		return cpus;
+	}
+
+	inline std::vector<int> nodeCpus(int node) {
+		std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		std::string list;
+		if (!file || !std::getline(file, list)) return {};
+		return parseCpuList(list);
+	}
+
+	inline int nodeCount() {
+		// Nodes are numbered densely on every machine we care about
+		int nodes = 0;
+		while (!nodeCpus(nodes).empty()) nodes++;
+		return std::max(nodes, 1);
+	}
+
+	inline int cpuNode(int cpu) {
+		for (int node = 0, nodes = nodeCount(); node < nodes; node++) {
+			std::vector<int> cpus = nodeCpus(node);
+			if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) return node;
+		}
+		return 0;
+	}
+
+	inline int currentCpu() {
+#ifdef __linux__
+		return std::max(sched_getcpu(), 0);
+#else
+		return 0;
+#endif
+	}
+
+	// Cpus in the order OpenMP threads are pinned to them:
+	// "compact" fills node 0 first, so neighbouring threads (and their blocks of boids) share a node,
+	// "spread" deals threads round-robin over the nodes, anything else is an explicit cpu list.
+	inline std::vector<int> pinOrder(const std::string& spec) {
+		if (spec != "compact" && spec != "spread") return parseCpuList(spec);
+
+		std::vector<std::vector<int>> nodes;
+		for (int node = 0, count = nodeCount(); node < count; node++) nodes.push_back(nodeCpus(node));
+		if (nodes.empty() || nodes[0].empty()) {
+			// No /sys/devices/system/node, one node with every online cpu
+			nodes.assign(1, {});
+#ifdef __linux__
+			for (long cpu = 0, count = sysconf(_SC_NPROCESSORS_ONLN); cpu < count; cpu++) nodes[0].push_back(static_cast<int>(cpu));
+#endif
+		}
+
+		std::vector<int> order;
+		if (spec == "compact") {
+			for (const auto& cpus : nodes) order.insert(order.end(), cpus.begin(), cpus.end());
+			return order;
+		}
+		for (size_t k = 0; ; k++) {
+			bool any = false;
+			for (const auto& cpus : nodes) {
+				if (k < cpus.size()) {
+					order.push_back(cpus[k]);
+					any = true;
+				}
+			}
+			if (!any) return order;
+		}
+	}
+
+	// Pins thread t of the current OpenMP team size to cpu order[t % cpus]. The runtime keeps its
+	// worker threads between parallel regions, so this holds until the team size changes.
+	// Returns false when the spec is invalid or pinning isn't supported here.
+	inline bool pinThreads(const std::string& spec) {
+		std::vector<int> order = pinOrder(spec);
+		if (order.empty()) return false;
+#ifdef __linux__
+		bool ok = true;
+		#pragma omp parallel reduction(&&:ok)
+		{
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(order[omp_get_thread_num() % order.size()], &set);
+			ok = sched_setaffinity(0, sizeof(set), &set) == 0;
+		}
+		return ok;
+#else
+		return false;
+#endif
+	}
+
+	// Node of every page in [data, data + bytes), -1 where unknown (not yet touched, no NUMA support)
+	inline std::vector<int> pageNodes(const void* data, size_t bytes) {
+		const uintptr_t page = 4096;
+		uintptr_t first = reinterpret_cast<uintptr_t>(data) & ~(page - 1);
+		uintptr_t last = reinterpret_cast<uintptr_t>(data) + bytes;
+		std::vector<void*> pages;
+		for (uintptr_t p = first; p < last; p += page) pages.push_back(reinterpret_cast<void*>(p));
+		std::vector<int> status(pages.size(), -1);
+#if defined(__linux__) && defined(SYS_move_pages)
+		// move_pages without target nodes only reports where the pages are
+		if (!pages.empty() && syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0) != 0) {
+			std::fill(status.begin(), status.end(), -1);
+		}
+#endif
+		for (int& node : status) node = std::max(node, -1);
+		return status;
+	}
+}
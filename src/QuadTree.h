@@ -0,0 +1,183 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "Boid.h"
+
+class QuadTree {
+    /*
+    Barnes-Hut style quadtree used for the far-field part of flocking.
+    Every node keeps the aggregated position sum, heading sum and boid count of
+    everything below it, so a whole distant group can be treated as a single
+    "super boid" when it is small enough compared to its distance (opening angle).
+    The tree is rebuilt from scratch every step, which is O(N log N).
+    */
+public:
+    struct Node {
+        glm::vec2 minB, maxB;       // tight bounds of the boids in this node
+        glm::vec2 sumPos;           // sum of positions (center of mass * count)
+        glm::vec2 sumHeading;       // sum of normalized directions
+        int count;
+        int first;                  // offset into 'order'
+        int child[4];               // -1 when the quadrant is empty or node is a leaf
+    };
+
+    int leafSize = 8;
+    int maxDepth = 24;
+
+    void build(const std::vector<Boid>& boids) {
+
+        int numBoids = static_cast<int>(boids.size());
+
+        nodes.clear();
+        order.resize(numBoids);
+        positions.resize(numBoids);
+        headings.resize(numBoids);
+
+        for (int i = 0; i < numBoids; i++) {
+            order[i] = i;
+            positions[i] = boids[i].pos;
+            float len = glm::length(boids[i].dir);
+            headings[i] = len > 0.0f ? boids[i].dir / len : glm::vec2(0.0f);
+        }
+
+        if (numBoids == 0) return;
+
+        // Worst case is ~2N nodes for leafSize 1, reserve so children don't reallocate mid-build
+        nodes.reserve(2 * (numBoids / std::max(leafSize, 1)) + 64);
+        buildNode(0, numBoids, 0);
+    }
+
+    // Accumulates boids between nearRadius and farRadius from p.
+    // Returns the number of boids represented in sumPos / sumHeading.
+    int queryFarField(glm::vec2 p, float nearRadius, float farRadius, float theta,
+                      glm::vec2& sumPos, glm::vec2& sumHeading) const {
+
+        sumPos = { 0.0f, 0.0f };
+        sumHeading = { 0.0f, 0.0f };
+        if (nodes.empty()) return 0;
+
+        float nearSq = nearRadius * nearRadius;
+        float farSq  = farRadius * farRadius;
+        float thetaSq = theta * theta;
+        int   total  = 0;
+
+        int stack[4 * 64];
+        int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+
+            // Whole node out of range or whole node inside the exact near field
+            if (minDistSq(p, node) >= farSq) continue;
+            if (maxDistSq(p, node) < nearSq) continue;
+
+            glm::vec2 com = node.sumPos / (float)node.count;
+            glm::vec2 toCom = com - p;
+            float distSq = glm::dot(toCom, toCom);
+            glm::vec2 extent = node.maxB - node.minB;
+            float size = std::max(extent.x, extent.y);
+
+            if (size * size < thetaSq * distSq && distSq >= nearSq && distSq < farSq) {
+                sumPos += node.sumPos;
+                sumHeading += node.sumHeading;
+                total += node.count;
+                continue;
+            }
+
+            if (isLeaf(node)) {
+                for (int k = node.first; k < node.first + node.count; k++) {
+                    int id = order[k];
+                    glm::vec2 d = positions[id] - p;
+                    float dSq = glm::dot(d, d);
+                    if (dSq < nearSq || dSq >= farSq) continue;
+                    sumPos += positions[id];
+                    sumHeading += headings[id];
+                    total++;
+                }
+                continue;
+            }
+
+            for (int c = 0; c < 4; c++) {
+                if (node.child[c] >= 0 && top < (int)(sizeof(stack) / sizeof(stack[0]))) stack[top++] = node.child[c];
+            }
+        }
+
+        return total;
+    }
+
+    size_t nodeCount() const { return nodes.size(); }
+
+private:
+    std::vector<Node> nodes;
+    std::vector<int> order;
+    std::vector<glm::vec2> positions;
+    std::vector<glm::vec2> headings;
+
+    static bool isLeaf(const Node& n) {
+        return n.child[0] < 0 && n.child[1] < 0 && n.child[2] < 0 && n.child[3] < 0;
+    }
+
+    static float minDistSq(glm::vec2 p, const Node& n) {
+        float dx = std::max({ n.minB.x - p.x, 0.0f, p.x - n.maxB.x });
+        float dy = std::max({ n.minB.y - p.y, 0.0f, p.y - n.maxB.y });
+        return dx * dx + dy * dy;
+    }
+
+    static float maxDistSq(glm::vec2 p, const Node& n) {
+        float dx = std::max(std::abs(p.x - n.minB.x), std::abs(p.x - n.maxB.x));
+        float dy = std::max(std::abs(p.y - n.minB.y), std::abs(p.y - n.maxB.y));
+        return dx * dx + dy * dy;
+    }
+
+    int buildNode(int first, int last, int depth) {
+
+        int index = static_cast<int>(nodes.size());
+        nodes.push_back({});
+
+        Node node;
+        node.first = first;
+        node.count = last - first;
+        node.sumPos = { 0.0f, 0.0f };
+        node.sumHeading = { 0.0f, 0.0f };
+        node.minB = positions[order[first]];
+        node.maxB = node.minB;
+        for (int c = 0; c < 4; c++) node.child[c] = -1;
+
+        for (int k = first; k < last; k++) {
+            int id = order[k];
+            node.sumPos += positions[id];
+            node.sumHeading += headings[id];
+            node.minB = glm::min(node.minB, positions[id]);
+            node.maxB = glm::max(node.maxB, positions[id]);
+        }
+
+        if (node.count > leafSize && depth < maxDepth) {
+
+            glm::vec2 mid = (node.minB + node.maxB) * 0.5f;
+            auto begin = order.begin() + first;
+            auto end = order.begin() + last;
+
+            // Split on y first, then each half on x -> 4 contiguous quadrant ranges
+            auto splitY = std::partition(begin, end, [&](int id) { return positions[id].y < mid.y; });
+            auto splitX0 = std::partition(begin, splitY, [&](int id) { return positions[id].x < mid.x; });
+            auto splitX1 = std::partition(splitY, end, [&](int id) { return positions[id].x < mid.x; });
+
+            int bounds[5] = {
+                first,
+                static_cast<int>(splitX0 - order.begin()),
+                static_cast<int>(splitY - order.begin()),
+                static_cast<int>(splitX1 - order.begin()),
+                last
+            };
+
+            for (int c = 0; c < 4; c++) {
+                if (bounds[c + 1] > bounds[c]) node.child[c] = buildNode(bounds[c], bounds[c + 1], depth + 1);
+            }
+        }
+
+        nodes[index] = node;
+        return index;
+    }
+};
@@ -0,0 +1,176 @@
+#pragma once
+#include <algorithm>
+#include "Simulation.h"
+
+// Holds a frame-time budget by trading simulation and rendering quality.
+// Every frame it gets the measured simulation and frame times, keeps a smoothed estimate of
+// both and moves along two ladders: the simulation ladder (substeps, neighbor caps, multi-rate)
+// and the draw ladder (point sprites instead of triangles, then share of the flock that is drawn).
+// Whichever side costs more is degraded first, recovery goes the other way round. Manual
+// settings are restored when it is turned off. The density field stays RenderLod's call: it
+// depends on the zoom and replaces the boids altogether, too big a step for a frame-rate dip.
+class QualityController {
+public:
+
+	bool  enabled   = false;
+	float targetFPS = 60.0f;
+	float margin    = 0.9f;    // aim for 90% of the frame to absorb spikes
+
+	// Simulation ladder, step 0 is the best quality
+	struct SimStep {
+		const char* name;
+		int  substeps;
+		int  neighborCap;      // 0 = metric friends, otherwise topological k
+		int  multiRateLevel;   // 0 = every boid every step
+	};
+	static const int simSteps = 6;
+	const SimStep simLadder[simSteps] = {
+		{ "2 substeps",                2, 0,  0 },
+		{ "1 substep",                 1, 0,  0 },
+		{ "16 neighbors",              1, 16, 0 },
+		{ "7 neighbors",               1, 7,  0 },
+		{ "7 neighbors, multi-rate 4", 1, 7,  2 },
+		{ "7 neighbors, multi-rate 8", 1, 7,  3 },
+	};
+
+	// Draw ladder: every stride-th boid is drawn, as point sprites where RenderLod would pick triangles
+	struct DrawStep {
+		const char* name;
+		int  stride;
+		bool points;
+	};
+	static const int drawSteps = 5;
+	const DrawStep drawLadder[drawSteps] = {
+		{ "every boid",                    1, false },
+		{ "every boid as a point",         1, true  },
+		{ "every 2nd boid as a point",     2, true  },
+		{ "every 4th boid as a point",     4, true  },
+		{ "every 8th boid as a point",     8, true  },
+	};
+
+	int simLevel  = 1;
+	int drawLevel = 0;
+
+	// Smoothed measurements, milliseconds
+	float simMs    = 0.0f;
+	float frameMs  = 0.0f;
+	float renderMs = 0.0f;     // everything in the frame that isn't simulation
+	float headroom = 0.0f;     // budget - frame time, negative when over budget
+
+	int substeps() const { return enabled ? simLadder[simLevel].substeps : 1; }
+	int drawStride() const { return enabled ? drawLadder[drawLevel].stride : 1; }
+	bool drawPoints() const { return enabled && drawLadder[drawLevel].points; }
+	const char* simDecision() const { return simLadder[simLevel].name; }
+	const char* drawDecision() const { return drawLadder[drawLevel].name; }
+
+	float budgetMs() const {
+		return 1000.0f / std::max(targetFPS, 1.0f) * margin;
+	}
+
+	void apply(Simulation& sim) {
+		// Pushes the current simulation step onto the simulation, remembering the manual settings
+		if (!enabled) {
+			if (applied) restore(sim);
+			return;
+		}
+		if (!applied) {
+			manual = { sim.topological, sim.topologicalK, sim.multiRate, sim.maxRateLevel };
+			applied = true;
+		}
+
+		const SimStep& step = simLadder[simLevel];
+		sim.topological = step.neighborCap > 0;
+		if (step.neighborCap > 0) sim.topologicalK = step.neighborCap;
+		sim.multiRate = step.multiRateLevel > 0;
+		if (step.multiRateLevel > 0) sim.maxRateLevel = step.multiRateLevel;
+	}
+
+	void observe(float measuredFrameMs, float measuredSimMs, int population) {
+		// Called once per frame, after it was drawn, with that frame's whole time, the time it spent
+		// in sim.update() and the flock size
+		if (!enabled) return;
+
+		const float smoothing = 0.1f;
+		frameMs = frameMs > 0.0f ? frameMs + (measuredFrameMs - frameMs) * smoothing : measuredFrameMs;
+		simMs   = simMs > 0.0f ? simMs + (measuredSimMs - simMs) * smoothing : measuredSimMs;
+		renderMs = std::max(frameMs - simMs, 0.0f);
+		headroom = budgetMs() - frameMs;
+
+		// Give the smoothed numbers time to show the effect of the last decision
+		if (cooldown > 0) {
+			cooldown--;
+			return;
+		}
+
+		// What this simulation step costs per boid, used to predict the way back up
+		learnedCost[simLevel] = simMs / std::max(population, 1);
+		this->population = population;
+
+		if (headroom < 0.0f) {
+			calmFrames = 0;
+			degrade();
+		}
+		else if (frameMs < budgetMs() * 0.7f) {
+			// Recover only after a calm stretch, and only when the prediction fits the budget
+			if (++calmFrames >= 120) {
+				calmFrames = 0;
+				improve();
+			}
+		}
+		else {
+			calmFrames = 0;
+		}
+	}
+
+private:
+	struct Manual { bool topological; int topologicalK; bool multiRate; int maxRateLevel; } manual{};
+	bool applied    = false;
+	int  cooldown   = 0;
+	int  calmFrames = 0;
+	int  population = 0;
+	float learnedCost[simSteps] = {};   // ms per boid of each simulation step, 0 = never measured
+
+	void degrade() {
+		// The more expensive side gives up quality first
+		bool simHeavier = simMs >= renderMs;
+		bool canSim = simLevel < simSteps - 1;
+		bool canDraw = drawLevel < drawSteps - 1;
+
+		if (canSim && (simHeavier || !canDraw)) simLevel++;
+		else if (canDraw) drawLevel++;
+		else return;
+		cooldown = 30;
+	}
+
+	void improve() {
+		// Drawing everything comes back first, it is what people notice
+		if (drawLevel > 0) {
+			// Predicted render cost if twice as many boids are drawn, or triangles come back
+			if (simMs + renderMs * 2.0f < budgetMs()) drawLevel--;
+			else return;
+		}
+		else if (simLevel > 0) {
+			// Measured cost of the better step if it was seen before (scaled to today's flock),
+			// otherwise 2x for the extra substep and a cautious 3x for the neighbor settings
+			float predicted = learnedCost[simLevel - 1] > 0.0f
+				? learnedCost[simLevel - 1] * population
+				: simMs * (simLadder[simLevel - 1].substeps > simLadder[simLevel].substeps ? 2.0f : 3.0f);
+			if (predicted + renderMs < budgetMs()) simLevel--;
+			else return;
+		}
+		else {
+			return;
+		}
+		cooldown = 30;
+	}
+
+	void restore(Simulation& sim) {
+		sim.topological  = manual.topological;
+		sim.topologicalK = manual.topologicalK;
+		sim.multiRate    = manual.multiRate;
+		sim.maxRateLevel = manual.maxRateLevel;
+		applied = false;
+		simMs = frameMs = renderMs = headroom = 0.0f;
+		std::fill(learnedCost, learnedCost + simSteps, 0.0f);
+	}
+};
@@ -0,0 +1,132 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include "SpatialGrid.h"
+#include "LeanFlock.h"
+
+// Level of detail for drawing the flock. Boids are instanced triangles while they are a few
+// pixels long, point sprites once they shrink below that, and when the flock covers the screen
+// many times over it is drawn as one textured quad of grid cell occupancy, which costs the
+// same however many boids there are. The choice follows the on-screen boid size (scale) and
+// the population, with some hysteresis so it doesn't flicker at the thresholds.
+class RenderLod {
+public:
+
+	enum Mode { Triangles = 0, Points, Density };
+
+	bool  automatic         = true;
+	Mode  forced            = Triangles;   // used when automatic is off
+	float minTrianglePixels = 4.0f;        // boids shorter than this on screen become points
+	float maxOverdraw       = 8.0f;        // boids per screen pixel before switching to the density field
+	bool  preferPoints      = false;       // set by the quality controller: points wherever triangles would be drawn
+
+	Mode  mode       = Triangles;
+	float boidPixels = 0.0f;   // on-screen length of a boid
+	float pointSize  = 1.0f;
+	float overdraw   = 0.0f;   // pixels the flock would cover / screen pixels
+
+	static const char* name(Mode m) {
+		return m == Triangles ? "triangles" : m == Points ? "points" : "density";
+	}
+
+	Mode choose(float scale, size_t population, int screenWidth, int screenHeight) {
+
+		// The mesh is 0.015 long and 0.008 wide, the world is 2 units high on screen
+		boidPixels = 0.015f * scale * screenHeight * 0.5f;
+		float footprint = std::max(boidPixels * boidPixels * 0.27f, 1.0f);
+		overdraw = static_cast<float>(population) * footprint / std::max(screenWidth * screenHeight, 1);
+		pointSize = std::min(std::max(boidPixels * 0.5f, 1.0f), 8.0f);
+
+		if (!automatic) {
+			mode = forced;
+			return mode;
+		}
+
+		if (overdraw > maxOverdraw * (mode == Density ? 0.8f : 1.0f)) mode = Density;
+		else if (preferPoints || boidPixels < minTrianglePixels * (mode == Triangles ? 1.0f : 1.25f)) mode = Points;
+		else mode = Triangles;
+		return mode;
+	}
+};
+
+// Boids per grid cell laid out as a texture over the world, row-major from the bottom left
+struct DensityField {
+	std::vector<float> texels;
+	int       cols     = 0;
+	int       rows     = 0;
+	glm::vec2 origin   = { 0, 0 };
+	float     cellSize = 1.0f;
+	float     peak     = 0.0f;
+
+	static const int maxTexels = 1 << 20;
+
+	void fromGrid(const SpatialGrid& grid, float aspect) {
+
+		// Boids wrap 0.1 past the edges. Texel j spans [j, j+1) cells, but the grid truncates
+		// towards zero, so its cell 0 spans (-1, 1) and its negative cells sit one texel lower.
+		cellSize = grid.cellSize();
+		int halfCols = static_cast<int>(std::ceil((aspect + 0.1f) / cellSize));
+		int halfRows = static_cast<int>(std::ceil(1.1f / cellSize));
+		cols = 2 * halfCols;
+		rows = 2 * halfRows;
+		origin = { -halfCols * cellSize, -halfRows * cellSize };
+		texels.assign(static_cast<size_t>(cols) * rows, 0.0f);
+
+		for (const auto& cell : grid.cells()) {
+			float count = static_cast<float>(cell.second.size());
+			if (count == 0.0f) continue;
+
+			int x0 = cell.first.first > 0 ? cell.first.first : cell.first.first - 1;
+			int x1 = cell.first.first >= 0 ? cell.first.first : cell.first.first - 1;
+			int y0 = cell.first.second > 0 ? cell.first.second : cell.first.second - 1;
+			int y1 = cell.first.second >= 0 ? cell.first.second : cell.first.second - 1;
+			float share = count / ((x1 - x0 + 1) * (y1 - y0 + 1));
+
+			for (int y = y0; y <= y1; y++) {
+				for (int x = x0; x <= x1; x++) {
+					int tx = x + halfCols, ty = y + halfRows;
+					if (tx < 0 || ty < 0 || tx >= cols || ty >= rows) continue;
+					texels[static_cast<size_t>(ty) * cols + tx] += share;
+				}
+			}
+		}
+		findPeak();
+	}
+
+	void fromLean(const LeanFlock& lean) {
+
+		// The lean grid can have millions of cells, blocks of them are merged to stay under maxTexels
+		LeanFlock::GridInfo info = lean.gridInfo();
+		int block = 1;
+		while (static_cast<long long>((info.cols + block - 1) / block) * ((info.rows + block - 1) / block) > maxTexels) block++;
+
+		cols = (info.cols + block - 1) / block;
+		rows = (info.rows + block - 1) / block;
+		cellSize = info.cellSize * block;
+		origin = info.origin;
+		texels.assign(static_cast<size_t>(cols) * rows, 0.0f);
+
+		#pragma omp parallel for schedule(static)
+		for (int ty = 0; ty < rows; ty++) {
+			for (int tx = 0; tx < cols; tx++) {
+				uint32_t count = 0;
+				int yEnd = std::min((ty + 1) * block, info.rows);
+				int xEnd = std::min((tx + 1) * block, info.cols);
+				for (int cy = ty * block; cy < yEnd; cy++) {
+					for (int cx = tx * block; cx < xEnd; cx++) count += lean.cellCount(cx, cy);
+				}
+				texels[static_cast<size_t>(ty) * cols + tx] = static_cast<float>(count);
+			}
+		}
+		findPeak();
+	}
+
+private:
+	void findPeak() {
+		peak = 0.0f;
+		for (float t : texels) peak = std::max(peak, t);
+	}
+};
@@ -5,19 +5,34 @@
 #include <glm/glm.hpp>
 #include <omp.h>
 #include "SpatialGrid.h"
+#include "QuadTree.h"
+#include "TaskScheduler.h"
+#include "CommandBuffer.h"
+#include "FlockQuery.h"
+#include "FlockAnalytics.h"
+#include "ForceField.h"
+#include "Numa.h"
 #include <unordered_set>
+#include <algorithm>
+#include <memory>
+#include <string>
 
 
 class Simulation {
 public:
 	Simulation() = default;
-	Simulation(unsigned int N, float aspect) : aspect(aspect) {
+	Simulation(unsigned int N, float aspect, unsigned int seed = 0) : aspect(aspect), seed(seed) {
 		setupSimulation(N);
 	};
 
 	std::vector<Boid> Boids;
 	float aspect;
 
+	// Non-zero seed makes setup, spawns and steering noise reproducible
+	unsigned int seed  = 0;
+	unsigned int nextId = 0;
+	std::mt19937 seededGen;
+
 	float fov          = 0.5f;
 	float fovRadius    = 0.1f;
 	int   frameCount   = 0;
@@ -30,21 +45,127 @@ public:
 
 	bool  atract       = false;
 	bool  repel        = false; 
+	float mouseRadius  = 3.45f;  // the mouse force is cut off here, exp(-2d) is 0.1% of its peak there
 	bool  bounce       = true;
 	bool  friendVisual = false;
 	bool  speedCol     = false;
 
+	// Barnes-Hut far field: cohesion/alignment from boids between fovRadius and farRadius
+	bool  farField     = false;
+	float farRadius    = 0.5f;
+	float theta        = 0.5f;
+	float farStrength  = 0.3f;
+
+	// Incremental grid: cells are kept between steps and only boids that changed cell move.
+	// Moves leave grown-out cell blocks behind in the grid's arena, so every rebuildInterval
+	// steps the grid is rebuilt from scratch, which files every cell densely again.
+	bool  incrementalGrid  = false;
+	int   rebuildInterval  = 120;
+	int   gridMoved        = 0;     // boids moved last step, -1 when the grid was rebuilt
+
+	// Work-stealing scheduler over grid cells, used instead of OpenMP for dense clusters
+	bool  useTaskScheduler = false;
+
+	// Topological neighbors: every boid follows only its k closest visible neighbors (starlings use ~7),
+	// so Boid::update costs O(k) however dense the flock gets
+	bool  topological  = false;
+	int   topologicalK = 7;
+	bool  predatorsAround = false;
+
+	// Flock analytics every analyticsInterval steps, shown in the GUI and appended to metricsPath
+	bool        analytics         = false;
+	int         analyticsInterval = 30;
+	std::string metricsPath       = "flock_metrics.csv";
+	FlockAnalytics flockStats;
+
+	// Multi-rate integration: boids whose heading and neighborhood barely change are evaluated
+	// every 2/4/8 steps and coast in a straight line in between. Predators, boids near predators
+	// and boids under the mouse force or inside an emitter's range are always evaluated.
+	bool  multiRate       = false;
+	int   maxRateLevel    = 3;      // evaluated at least every 2^maxRateLevel steps
+	float settleAngle     = 0.1f;   // heading change per evaluation (radians) that still counts as settled
+	int   settleNeighbors = 2;      // change in friend count that still counts as settled
+	float mouseWakeRadius = 1.0f;   // the mouse force is still ~15% of its peak at this distance
+	std::vector<char> due;          // evaluated this step
+	int   dueCount        = 0;
+
+	// NUMA locality for multi-socket hosts: every thread first touches the boids of its static block,
+	// the boids are re-sorted by grid cell every reorderInterval steps so a block is also a band of
+	// grid cells, each band's cells are filled by the thread that owns the band and the friend search
+	// runs on the same static blocks as the update. pinning keeps the threads on their cores:
+	// "compact", "spread" or a cpu list like "0-15,32-47", empty leaves it to the OS (or OMP_PLACES).
+	bool        numaLocal       = false;
+	int         reorderInterval = 32;
+	std::string pinning;
+	int         localThreads    = 0;      // team size the boids were last placed for
+	int         sortedFrame     = -1;     // step of the last sort by cell
+	float       sortedCellSize  = 0.0f;
+	bool        justSorted      = false;
+	std::vector<Boid> sortedBoids;        // the other half of the sort's double buffer
+	std::vector<int>  cellKeys;
+	std::vector<int>  cellOffsets;        // per thread and cell during the sort
+	std::vector<int>  bandKeys;           // first grid cell of each thread's block after the sort
+
+	// Wall time of the phases of the last update(), in milliseconds
+	struct PhaseTimes {
+		float friends  = 0.0f;   // grid build and friend lists (spawns/kills included)
+		float farField = 0.0f;
+		float update   = 0.0f;   // analytics, inspector and boid updates
+		float total    = 0.0f;
+	} phaseMs;
+
+	// Neighbor inspector: ctrl + left click picks a boid, its neighbors come from one grid query
+	struct Inspection {
+		bool         selected    = false;
+		unsigned int id          = 0;
+		int          index       = -1;
+		int          neighbors   = 0;   // boids it sees (both sides of the friend rule)
+		int          predators   = 0;
+		int          friendsUsed = 0;   // friends this step actually used (higher id only)
+		glm::vec2    alignment   = { 0, 0 };
+		glm::vec2    cohesion    = { 0, 0 };
+		glm::vec2    separation  = { 0, 0 };
+		glm::vec2    avoidance   = { 0, 0 };
+	} inspection;
+	std::vector<int> inspectNearby;
+	std::vector<int> inspectHits;
+
 	glm::vec2 mousePoint;
+
+	// Attractors, repellers and vortices with a cutoff radius each, binned into their own grid
+	ForceField forceField;
+
+	// Spawn/kill requests, applied in one batch at the start of the next step
+	CommandBuffer commands;
+	std::vector<char> killMarks;
+	std::vector<SimCommand> pendingSpawns;
+
 	SpatialGrid grid{ fovRadius };
+	float gridSlack = 0.0f;   // how far boids may have moved since the grid was built
+	QuadTree quadTree;
+
+	struct CellTask { int begin, end; };
+	std::unique_ptr<TaskScheduler> scheduler;
+	std::vector<int>      taskBoids;   // boid ids grouped by cell, tasks are ranges of it
+	std::vector<CellTask> cellTasks;
+	std::vector<float>    taskWeights;
+	std::vector<std::vector<int>> threadNearby;  // per-thread scratch for grid queries
+	std::vector<std::vector<std::pair<float, int>>> threadClosest;  // per-thread k-closest heaps
+	std::vector<Arena>            arenas;        // per-thread storage for friend lists, reset every step
 	
 	void setupSimulation(unsigned int N) {
 
 		std::uniform_real_distribution<float> posY(-1.0f, 1.0f);
 		std::uniform_real_distribution<float> posX(-aspect, aspect);
 		std::random_device rd;
-		std::mt19937 gen(rd());
-
-	
+		if (seed) seededGen.seed(seed);
+		std::mt19937 rdGen(rd());
+		std::mt19937& gen = seed ? seededGen : rdGen;
+
+		// With numaLocal the pages go to the threads whose static block they hold, the serial fill
+		// below doesn't move them. Otherwise no OpenMP here, forked children (BoidsDomain) can't use it.
+		if (numaLocal) numa::reserveLocal(Boids, Boids.size() + N);
+		else Boids.reserve(Boids.size() + N);
 		for (int i = 0; i < N; i++) {
 			glm::vec2 pos = { posX(gen), posY(gen) };
 			Boids.push_back(generateBoid(pos));
@@ -57,7 +178,8 @@ public:
 		std::uniform_real_distribution<float> color(0.0f, 1.0f);
 		std::uniform_real_distribution<float> gradient(0.0f, 0.5f);
 		std::random_device rd;
-		std::mt19937 gen(rd());
+		std::mt19937 rdGen(rd());
+		std::mt19937& gen = seed ? seededGen : rdGen;
 
 		glm::vec2 posVec = pos;
 		glm::vec2 dirVec = { dir(gen), dir(gen) };
@@ -84,23 +206,91 @@ public:
 		} 
 
 		Boid b(posVec, dirVec, colorVec, predators);
+		b.id = nextId++;
 		return b;
 
 	}
 
 	void update(float dt) {
 
+		double start = omp_get_wtime();
+		applyCommands();
+		frameCount++;
+		if (!forceField.empty()) forceField.build(aspect);
+		if (numaLocal) placeBoids();
 		optimizedMadeFriends();
+		double friendsDone = omp_get_wtime();
+		if (farField) farFieldFriends();
+		double farDone = omp_get_wtime();
+		if (friendVisual) inspectSelected();
+		if (analyticsStep()) {
+			// Friend lists and grid are fresh here (for every boid, multi-rate too), analytics only reads them
+			flockStats.compute(Boids, grid, frameCount, topological);
+			if (!metricsPath.empty()) flockStats.writeRow(metricsPath);
+		}
 
 		int numBoids = static_cast<int>(Boids.size());
+		BoidParams params = boidParams(dt);
+
+		if (useTaskScheduler) {
+			// Same cell tasks as the neighbor search, cost of an update grows with the friend count
+			for (size_t t = 0; t < cellTasks.size(); t++) {
+				float w = 0.0f;
+				for (int k = cellTasks[t].begin; k < cellTasks[t].end; k++) {
+					const Boid& b = Boids[taskBoids[k]];
+					w += 1.0f + b.friends.size() + b.predators.size();
+				}
+				taskWeights[t] = w;
+			}
 
-		#pragma omp parallel for schedule(static)
-		for (int i = 0; i < numBoids; i++) {
-			Boids[i].update(alignment, cohesion, separation, aspect, dt, minSpeed, maxSpeed,
-				mousePoint, atract, repel, bounce, speedCol);
+			scheduler->run(taskWeights, [&](int task, int) {
+				for (int k = cellTasks[task].begin; k < cellTasks[task].end; k++) {
+					stepBoid(taskBoids[k], params);
+				}
+			});
+		}
+		else {
+			#pragma omp parallel for schedule(static)
+			for (int i = 0; i < numBoids; i++) {
+				stepBoid(i, params);
+			}
 		}
 
-		if (friendVisual) showFriends();
+		if (friendVisual) highlightSelected();
+
+		double end = omp_get_wtime();
+		phaseMs.friends  = static_cast<float>((friendsDone - start) * 1000.0);
+		phaseMs.farField = static_cast<float>((farDone - friendsDone) * 1000.0);
+		phaseMs.update   = static_cast<float>((end - farDone) * 1000.0);
+		phaseMs.total    = static_cast<float>((end - start) * 1000.0);
+
+		// Forces added after limitSpeed (mouse) can push a boid past maxSpeed, hence the 2x
+		gridSlack = 2.0f * maxSpeed * dt;
+	}
+
+	FlockQuery query() const {
+		// Spatial queries against this step's grid, valid until the next update()
+		return FlockQuery(grid, Boids, aspect, gridSlack);
+	}
+
+	size_t scratchPeak() const {
+		// Peak bytes of all per-step arenas, they only allocate when this grows
+		size_t total = grid.arenaPeak();
+		for (const Arena& arena : arenas) total += arena.peakBytes();
+		return total;
+	}
+
+	bool analyticsStep() const {
+		return analytics && analyticsInterval > 0 && frameCount % analyticsInterval == 0;
+	}
+
+	unsigned int stepNoiseSeed() const {
+		// 0 means "use the thread-local random generator"
+		if (!seed) return 0;
+		unsigned int h = seed * 0x9E3779B9u + static_cast<unsigned int>(frameCount);
+		h ^= h >> 16; h *= 0x7feb352du;
+		h ^= h >> 15;
+		return h | 1u;
 	}
 
 	void updateAspect(float aspectNew) {
@@ -109,10 +299,11 @@ public:
 
 	void madeFriends(float dt) {
 		// Fucking pointer typeshit friends making, breaking the KISS
+		resetScratch();
 		auto boid = Boids.begin();
 		while (boid < Boids.end()) {
-			(*boid).friends.clear();
-			(*boid).predators.clear();
+			(*boid).friends.reset(&arenas[0]);
+			(*boid).predators.reset(&arenas[0]);
 			auto potentialFriend = boid + 1;
 
 			while (potentialFriend < Boids.end()) {
@@ -128,62 +319,621 @@ public:
 
 		int numBoids = static_cast<int>(Boids.size());
 
-		// Phase 1: Clear lists and build grid (sequential - grid is not thread-safe for writes)
-		for (int id = 0; id < numBoids; id++) {
-			Boids[id].friends.clear();
-			Boids[id].predators.clear();
-			grid.insert(Boids[id], id);
+		// Cells follow the fov radius, otherwise the 3x3 query misses friends at large radii
+		grid.setCellSize(std::max(fovRadius, 0.01f));
+		// Wrapping lets boids go 0.1 past the edges
+		grid.reserveDomain(aspect + 0.1f, 1.1f);
+
+		// Last step's lists die with the arenas, every boid gets fresh ones in phase 2
+		resetScratch();
+
+		if (incrementalGrid) {
+			// Phase 1: Move only the boids that changed cell (rebuilds on big jumps)
+			if (justSorted) {
+				// Every boid has a new index after a sort
+				grid.rebuild(Boids);
+				gridMoved = -1;
+			}
+			else if (rebuildInterval > 0 && frameCount % rebuildInterval == 0) {
+				grid.rebuild(Boids);
+				gridMoved = -1;
+			}
+			else {
+				gridMoved = grid.update(Boids);
+			}
+		}
+		else if (numaLocal && grid.bandCount() > 0) {
+			// Phase 1: Every thread fills the cells of its own band (see placeBoids)
+			grid.buildBanded(Boids);
+		}
+		else {
+			// Phase 1: Build grid (sequential - grid is not thread-safe for writes)
+			// reset() keeps the cell vectors around so a steady frame doesn't reallocate them
+			grid.reset();
+			for (int id = 0; id < numBoids; id++) {
+				grid.insert(Boids[id], id);
+			}
+		}
+
+		justSorted = false;
+
+		// Query buffers sized for the densest cell before the queries, with room to spare,
+		// so they don't grow inside the parallel loops as the flock gets denser
+		size_t nearbyBound = 9 * grid.maxCellSize();
+		for (auto& nearby : threadNearby) {
+			if (nearby.capacity() < nearbyBound) nearby.reserve(2 * nearbyBound);
+		}
+
+		if (multiRate) planMultiRate();
+
+		if (topological) {
+			predatorsAround = std::any_of(Boids.begin(), Boids.end(), [](const Boid& b) { return b.isPredator; });
+		}
+
+		if (useTaskScheduler) {
+			scheduledMadeFriends();
+			return;
 		}
 
 		// Phase 2: Query neighbors and build friend lists (parallel)
-		// Each thread gets its own 'nearby' vector. Each boid writes only to its own lists.
+		// Each thread has its own 'nearby' vector and arena. Each boid writes only to its own lists.
 		#pragma omp parallel
 		{
-			std::vector<int> nearby;
-			nearby.reserve(64);
+			int thread = omp_get_thread_num();
+			std::vector<int>& nearby = threadNearby[thread];
+			Arena& arena = arenas[thread];
 
-			#pragma omp for schedule(dynamic)
-			for (int x = 0; x < numBoids; x++) {
+			auto findFriends = [&](int x) {
 				Boid& boid = Boids[x];
+				boid.friends.reset(&arena);
+				boid.predators.reset(&arena);
+				if (multiRate && !due[x]) return;
+
+				if (topological) {
+					closestFriends(x, threadClosest[thread]);
+					return;
+				}
 				grid.get_nearby(boid, nearby);
 
+				// Each pair once, from the smaller id: ids survive kills and the NUMA sort, indices don't
 				for (int neighbor_id : nearby) {
-					if (x >= neighbor_id) continue;
+					Boid& other = Boids[neighbor_id];
+					if (boid.id >= other.id) continue;
+					boid.getFriend(&other, fov, fovRadius);
+				}
+			};
+
+			// Dynamic balances dense clusters, the NUMA-local mode keeps every thread on its own block
+			if (numaLocal) {
+				#pragma omp for schedule(static)
+				for (int x = 0; x < numBoids; x++) findFriends(x);
+			}
+			else {
+				#pragma omp for schedule(dynamic)
+				for (int x = 0; x < numBoids; x++) findFriends(x);
+			}
+		}
+	}
+
+	void applyCommands() {
+
+		// Between steps nothing points into Boids yet (friend lists are rebuilt below), so the
+		// vector is free to reallocate. Kills are gathered first and compacted in one pass.
+		size_t spawnTotal = 0;
+		bool anyKill = false;
+		size_t numBoids = Boids.size();
+
+		killMarks.assign(numBoids, 0);
+		pendingSpawns.clear();
+
+		commands.drain([&](const SimCommand& command) {
+			if (command.type == SimCommand::Spawn) {
+				pendingSpawns.push_back(command);
+				spawnTotal += static_cast<size_t>(std::max(command.count, 0));
+				return;
+			}
+
+			float radius2 = command.radius * command.radius;
+			for (size_t i = 0; i < numBoids; i++) {
+				glm::vec2 offset = Boids[i].pos - command.pos;
+				if (glm::dot(offset, offset) <= radius2) {
+					killMarks[i] = 1;
+					anyKill = true;
+				}
+			}
+		});
+
+		if (anyKill) {
+			// Swap-compaction: the last live boid fills each hole, O(kills) moves instead of erase's O(N)
+			size_t last = numBoids;
+			for (size_t i = 0; i < last; i++) {
+				if (!killMarks[i]) continue;
+				while (last > i + 1 && killMarks[last - 1]) last--;
+				if (last > i + 1) Boids[i] = std::move(Boids[last - 1]);
+				last--;
+			}
+			Boids.erase(Boids.begin() + last, Boids.end());
+		}
+
+		if (spawnTotal) {
+			// Grow geometrically up front so a 100k spawn is one reallocation
+			size_t needed = Boids.size() + spawnTotal;
+			if (needed > Boids.capacity()) {
+				size_t capacity = std::max(needed, Boids.capacity() * 2);
+				if (numaLocal) numa::reserveLocal(Boids, capacity);
+				else Boids.reserve(capacity);
+			}
+
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			std::random_device rd;
+			std::mt19937 rdGen(rd());
+			std::mt19937& gen = seed ? seededGen : rdGen;
+
+			for (SimCommand& command : pendingSpawns) {
+				// Big batches are scattered over a disc that grows with the count,
+				// stacking 100k boids on one point would put them all in one grid cell
+				float spread = command.count > 1 ? 0.003f * std::sqrt(static_cast<float>(command.count)) : 0.0f;
+
+				for (int i = 0; i < command.count; i++) {
+					float r = spread * std::sqrt(unit(gen));
+					float angle = 6.2831853f * unit(gen);
+					glm::vec2 pos = command.pos + r * glm::vec2(std::cos(angle), std::sin(angle));
+					Boids.push_back(generateBoid(pos, command.predator));
+				}
+			}
+		}
+	}
+
+	void placeBoids() {
+
+		// A new team (or the first step) gets pinned and the boids move to pages its threads touch first
+		int threads = omp_get_max_threads();
+		if (threads != localThreads) {
+			if (!pinning.empty()) numa::pinThreads(pinning);
+			numa::reserveLocal(Boids, Boids.capacity());
+			sortedBoids = std::vector<Boid>();
+			localThreads = threads;
+			sortedFrame = -1;
+		}
+
+		float cellSize = std::max(fovRadius, 0.01f);
+		if (sortedFrame < 0 || cellSize != sortedCellSize || frameCount - sortedFrame >= reorderInterval) {
+			sortByCell(cellSize);
+		}
+	}
+
+	void sortByCell(float cellSize) {
+
+		// Stable counting sort of the boids by grid cell (row-major, SpatialGrid::cellKey) into the other buffer.
+		// Counts are kept per thread and cell so both passes run on the static blocks in parallel,
+		// and the result is the same as a serial sort for any thread count.
+		int numBoids = static_cast<int>(Boids.size());
+		int threads = localThreads;
+		sortedFrame = frameCount;
+		sortedCellSize = cellSize;
+		justSorted = true;
+		if (numBoids == 0) return;
+
+		grid.setCellSize(cellSize);
+		grid.reserveDomain(aspect + 0.1f, 1.1f);
+		int cells = grid.cellKeyCount();
+
+		if (sortedBoids.capacity() < Boids.capacity()) {
+			sortedBoids.clear();
+			numa::reserveLocal(sortedBoids, Boids.capacity());
+		}
+		if (sortedBoids.size() != Boids.size()) sortedBoids.resize(Boids.size(), Boids[0]);
+		cellKeys.resize(numBoids);
+		cellOffsets.assign(static_cast<size_t>(threads) * cells, 0);
+
+		#pragma omp parallel for schedule(static, 1)
+		for (int t = 0; t < threads; t++) {
+			numa::Block block = numa::staticBlock(numBoids, threads, t);
+			int* counts = &cellOffsets[static_cast<size_t>(t) * cells];
+			for (int i = block.begin; i < block.end; i++) {
+				cellKeys[i] = grid.cellKey(grid.getCell(Boids[i].pos.x, Boids[i].pos.y));
+				counts[cellKeys[i]]++;
+			}
+		}
+
+		// Cell by cell, thread by thread: boids keep their relative order within a cell
+		int next = 0;
+		for (int c = 0; c < cells; c++) {
+			for (int t = 0; t < threads; t++) {
+				int& slot = cellOffsets[static_cast<size_t>(t) * cells + c];
+				int count = slot;
+				slot = next;
+				next += count;
+			}
+		}
+
+		#pragma omp parallel for schedule(static, 1)
+		for (int t = 0; t < threads; t++) {
+			numa::Block block = numa::staticBlock(numBoids, threads, t);
+			int* offsets = &cellOffsets[static_cast<size_t>(t) * cells];
+			for (int i = block.begin; i < block.end; i++) sortedBoids[offsets[cellKeys[i]]++] = Boids[i];
+		}
+		Boids.swap(sortedBoids);
+
+		// Every block now covers a run of cells, its band starts at the cell of its first boid
+		bandKeys.resize(threads);
+		for (int t = 0; t < threads; t++) {
+			numa::Block block = numa::staticBlock(numBoids, threads, t);
+			int key = block.begin < numBoids ? grid.cellKey(grid.getCell(Boids[block.begin].pos.x, Boids[block.begin].pos.y)) : cells;
+			bandKeys[t] = t > 0 ? std::max(key, bandKeys[t - 1]) : key;
+		}
+		grid.setBands(bandKeys);
+	}
+
+	void resetScratch() {
+
+		// One arena and one query buffer per thread, for OpenMP and the task scheduler alike
+		size_t numThreads = static_cast<size_t>(omp_get_max_threads());
+		if (useTaskScheduler) {
+			if (!scheduler) scheduler = std::make_unique<TaskScheduler>();
+			numThreads = std::max(numThreads, static_cast<size_t>(scheduler->threadCount()));
+		}
+
+		if (arenas.size() < numThreads) {
+			arenas.resize(numThreads);
+			threadNearby.resize(numThreads);
+			threadClosest.resize(numThreads);
+			for (auto& nearby : threadNearby) nearby.reserve(256);
+		}
 
+		for (Boid& boid : Boids) {
+			boid.friends.reset(nullptr);
+			boid.predators.reset(nullptr);
+		}
+		for (Arena& arena : arenas) arena.reset();
+	}
+
+	void buildCellTasks() {
+
+		if (!scheduler) scheduler = std::make_unique<TaskScheduler>();
+		int numThreads = scheduler->threadCount();
+
+		taskBoids.clear();
+		cellTasks.clear();
+
+		// Cost of a cell is occupancy * (boids in its 3x3 block), i.e. ~occupancy^2 in a tight flock
+		float total = 0.0f;
+		for (const auto& cell : grid.cells()) {
+			total += (float)cell.second.size() * grid.count_nearby(cell.first);
+		}
+
+		// Split heavy cells so that no single task is more than a fraction of a thread's share
+		float maxWeight = std::max(1.0f, total / (numThreads * 8.0f));
+
+		for (const auto& cell : grid.cells()) {
+			const ScratchList<int>& ids = cell.second;
+			int perBoid = std::max(1, grid.count_nearby(cell.first));
+			int chunk = std::max(1, static_cast<int>(maxWeight / perBoid));
+
+			for (size_t k = 0; k < ids.size(); k += chunk) {
+				int begin = static_cast<int>(taskBoids.size());
+				size_t stop = std::min(ids.size(), k + chunk);
+				taskBoids.insert(taskBoids.end(), ids.begin() + k, ids.begin() + stop);
+				cellTasks.push_back({ begin, static_cast<int>(taskBoids.size()) });
+			}
+		}
+
+		taskWeights.resize(cellTasks.size());
+	}
+
+	void scheduledMadeFriends() {
+
+		buildCellTasks();
+
+		for (size_t t = 0; t < cellTasks.size(); t++) {
+			const Boid& first = Boids[taskBoids[cellTasks[t].begin]];
+			int perBoid = grid.count_nearby(grid.getCell(first.pos.x, first.pos.y));
+			taskWeights[t] = (float)(cellTasks[t].end - cellTasks[t].begin) * perBoid;
+		}
+
+		scheduler->run(taskWeights, [&](int task, int thread) {
+			std::vector<int>& nearby = threadNearby[thread];
+			Arena& arena = arenas[thread];
+
+			for (int k = cellTasks[task].begin; k < cellTasks[task].end; k++) {
+				int x = taskBoids[k];
+				Boid& boid = Boids[x];
+				boid.friends.reset(&arena);
+				boid.predators.reset(&arena);
+				if (multiRate && !due[x]) continue;
+
+				if (topological) {
+					closestFriends(x, threadClosest[thread]);
+					continue;
+				}
+				grid.get_nearby(boid, nearby);
+
+				for (int neighbor_id : nearby) {
 					Boid& other = Boids[neighbor_id];
+					if (boid.id >= other.id) continue;
 					boid.getFriend(&other, fov, fovRadius);
 				}
 			}
+		});
+	}
+
+	void planMultiRate() {
+
+		// Staggered by id so every step evaluates about the same share of each level. Analytics steps
+		// evaluate everyone: coasting boids have empty friend lists and would split every flock.
+		int numBoids = static_cast<int>(Boids.size());
+		due.resize(numBoids);
+		bool everyone = analyticsStep();
+		bool mouseForce = atract || repel;
+		bool fieldForce = !forceField.empty();
+		float wake = std::min(mouseWakeRadius, mouseRadius);
+		float wakeSq = wake * wake;
+
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < numBoids; i++) {
+			Boid& boid = Boids[i];
+			glm::vec2 toMouse = boid.pos - mousePoint;
+			if (mouseForce && glm::dot(toMouse, toMouse) < wakeSq) boid.rateLevel = 0;
+			if (fieldForce && forceField.reaches(boid.pos)) boid.rateLevel = 0;
+
+			unsigned int period = 1u << boid.rateLevel;
+			due[i] = everyone || boid.isPredator || boid.rateLevel == 0 || ((frameCount + boid.id) & (period - 1)) == 0;
 		}
 
-		grid.clear();
+		// Predators wake everything in the cells around them, a coasting boid would not notice them
+		for (int i = 0; i < numBoids; i++) {
+			if (!Boids[i].isPredator) continue;
+			grid.get_nearby(Boids[i], threadNearby[0]);
+			for (int id : threadNearby[0]) {
+				due[id] = 1;
+				Boids[id].rateLevel = 0;
+			}
+		}
+
+		dueCount = static_cast<int>(std::count(due.begin(), due.end(), 1));
 	}
 
-	void showFriends() {
+	BoidParams boidParams(float dt) const {
+		// This step's settings for Boid::update
+		BoidParams params;
+		params.alignment        = alignment;
+		params.cohesion         = cohesion;
+		params.separation       = separation;
+		params.aspect           = aspect;
+		params.deltaTime        = dt;
+		params.steerTime        = dt;
+		params.minSpeed         = minSpeed;
+		params.maxSpeed         = maxSpeed;
+		params.mousePoint       = mousePoint;
+		params.atract           = atract;
+		params.repel            = repel;
+		params.mouseRadius      = mouseRadius;
+		params.bounce           = bounce;
+		params.speedBasedColor  = speedCol;
+		params.farFieldStrength = farField ? farStrength : 0.0f;
+		params.noiseSeed        = stepNoiseSeed();
+		return params;
+	}
 
-		auto boid = Boids.begin();
+	void stepBoid(int i, const BoidParams& params) {
 
-		while (boid != Boids.begin()+1) {
+		Boid& boid = Boids[i];
+		if (!multiRate) {
+			glm::vec2 field = forceField.empty() ? glm::vec2(0.0f) : forceField.force(boid.pos);
+			boid.update(params, field);
+			boid.coasted = 0;
+			return;
+		}
+		if (!due[i]) {
+			boid.coast(params.deltaTime, aspect, bounce);
+			return;
+		}
 
-			(*boid).friends.clear();
+		// Steering covers every step since the last evaluation, else settled boids would turn
+		// 2x-8x slower than at full rate. Position still moves by one step.
+		BoidParams catchUp = params;
+		catchUp.steerTime = params.deltaTime * static_cast<float>(boid.coasted + 1);
+		boid.coasted = 0;
+
+		glm::vec2 before = boid.dir;
+		glm::vec2 field = forceField.empty() ? glm::vec2(0.0f) : forceField.force(boid.pos);
+		boid.update(catchUp, field);
+
+		// One level slower while it stays settled, straight back to every step when it doesn't
+		int neighbors = static_cast<int>(boid.friends.size());
+		float turn = glm::dot(glm::normalize(before), glm::normalize(boid.dir));
+		bool settled = !boid.isPredator && boid.predators.empty()
+			&& turn >= std::cos(settleAngle)
+			&& std::abs(neighbors - boid.lastNeighbors) <= settleNeighbors;
+
+		boid.rateLevel = settled ? std::min(boid.rateLevel + 1, maxRateLevel) : 0;
+		boid.lastNeighbors = neighbors;
+	}
 
-			auto potentialFriend = boid + 1;
-			
-			while (potentialFriend != Boids.end()) {
+	void closestFriends(int x, std::vector<std::pair<float, int>>& closest) {
+
+		// Bounded partial selection straight over the grid cells: a max-heap of the k closest visible
+		// neighbors. The boid's own cell goes first, then a neighboring cell is skipped entirely once
+		// it lies further away than the current k-th, so dense clusters rarely look past one cell.
+		// Both sides of the smaller-id pair rule are scanned, the k closest are not symmetric.
+		Boid& boid = Boids[x];
+		size_t k = static_cast<size_t>(std::max(topologicalK, 1));
+		float radiusSq = fovRadius * fovRadius;
+		float halfFov = fov * 0.5f;
+		glm::vec2 heading = glm::normalize(boid.dir);
+		auto home = grid.getCell(boid.pos.x, boid.pos.y);
+		closest.clear();
+
+		for (int c = 0; c < 9; c++) {
+			// c == 0 is the home cell, 1..8 its neighbors
+			int dx = c == 0 ? 0 : (c <= 4 ? c - 1 : c) % 3 - 1;
+			int dy = c == 0 ? 0 : (c <= 4 ? c - 1 : c) / 3 - 1;
+			std::pair<int, int> cell = { home.first + dx, home.second + dy };
+
+			if (c > 0) {
+				// Predators count at any range, with some around only the fov radius prunes cells
+				float limit = closest.size() == k && !predatorsAround ? closest.front().first : radiusSq;
+				if (grid.cellDistanceSq(cell, boid.pos) >= limit) continue;
+			}
+			const ScratchList<int>* ids = grid.findCell(cell);
+			if (!ids) continue;
+
+			for (int neighbor_id : *ids) {
+				if (neighbor_id == x) continue;
 
-				if ((*boid).getFriend(&(*potentialFriend), fov, fovRadius)) {
-					(*boid).friends.push_back(&(*potentialFriend));
-					(*potentialFriend).visColor = { 0,0,1 };
-					(*boid).visColor = { 1,0,0 };
+				Boid& other = Boids[neighbor_id];
+				glm::vec2 toOther = other.pos - boid.pos;
+				float distSq = glm::dot(toOther, toOther);
+				if (distSq >= radiusSq || distSq == 0.0f) continue;
+
+				// Predators are never capped, running away from every one in range matters more
+				if (other.isPredator) {
+					boid.predators.push_back(&other);
+					continue;
+				}
+
+				// Cheapest rejection first: no better than the current k-th, then the view cone
+				// (same test as Boid::sees with the normalization folded into the distance)
+				if (closest.size() == k && distSq >= closest.front().first) continue;
+				if (glm::dot(heading, -toOther) > halfFov * std::sqrt(distSq)) continue;
+
+				if (closest.size() < k) {
+					closest.push_back({ distSq, neighbor_id });
+					std::push_heap(closest.begin(), closest.end());
 				}
 				else {
-					(*potentialFriend).visColor = { 0.2,0.2,0.2 };
+					std::pop_heap(closest.begin(), closest.end());
+					closest.back() = { distSq, neighbor_id };
+					std::push_heap(closest.begin(), closest.end());
 				}
-				potentialFriend++;
+			}
+		}
+
+		for (const auto& entry : closest) boid.friends.push_back(&Boids[entry.second]);
+	}
+
+	void farFieldFriends() {
+
+		// Rebuilt every step, O(N log N). Near field (< fovRadius) stays with the exact grid path.
+		quadTree.build(Boids);
+
+		int numBoids = static_cast<int>(Boids.size());
 
+		#pragma omp parallel for schedule(dynamic, 256)
+		for (int i = 0; i < numBoids; i++) {
+			if (multiRate && !due[i]) continue;
+			Boid& boid = Boids[i];
+			glm::vec2 sumPos, sumHeading;
+			int count = quadTree.queryFarField(boid.pos, fovRadius, farRadius, theta, sumPos, sumHeading);
+
+			boid.farCount = count;
+			if (count > 0) {
+				boid.farCenter = sumPos / (float)count;
+				boid.farHeading = sumHeading / (float)count;
 			}
-			boid++;
 		}
 	}
+
+	bool selectBoid(glm::vec2 point, float pickRadius = 0.03f) {
+
+		// Nearest boid to the click among the cells around it
+		grid.get_nearby(point, inspectNearby);
+		int best = -1;
+		float bestDist = pickRadius * pickRadius;
+
+		for (int id : inspectNearby) {
+			if (id >= static_cast<int>(Boids.size())) continue;
+			glm::vec2 offset = Boids[id].pos - point;
+			float dist = glm::dot(offset, offset);
+			if (dist < bestDist) {
+				bestDist = dist;
+				best = id;
+			}
+		}
+
+		inspection = Inspection();
+		inspectHits.clear();
+		if (best < 0) return false;
+
+		inspection.selected = true;
+		inspection.id = Boids[best].id;
+		inspection.index = best;
+		return true;
+	}
+
+	void inspectSelected() {
+
+		// Runs right after the friend lists are built, so the forces match this step. O(k) in the
+		// selected boid's neighborhood, except for a one-off search when compaction or a sort moved it.
+		inspectHits.clear();
+		if (!inspection.selected) return;
+
+		int numBoids = static_cast<int>(Boids.size());
+		if (inspection.index < 0 || inspection.index >= numBoids || Boids[inspection.index].id != inspection.id) {
+			inspection.index = -1;
+			for (int i = 0; i < numBoids; i++) {
+				if (Boids[i].id == inspection.id) {
+					inspection.index = i;
+					break;
+				}
+			}
+			if (inspection.index < 0) {
+				inspection.selected = false;   // killed
+				return;
+			}
+		}
+
+		const Boid& boid = Boids[inspection.index];
+		glm::vec2 alignmentSum(0.0f), cohesionSum(0.0f), separationSum(0.0f), avoidanceSum(0.0f);
+		int neighbors = 0, predators = 0;
+
+		grid.get_nearby(boid, inspectNearby);
+		for (int id : inspectNearby) {
+			const Boid& other = Boids[id];
+			if (!boid.sees(other, fov, fovRadius)) continue;
+
+			inspectHits.push_back(id);
+			glm::vec2 toOther = other.pos - boid.pos;
+
+			if (other.isPredator) {
+				predators++;
+				if (!boid.isPredator) {
+					float distance = glm::length(toOther);
+					avoidanceSum += -glm::normalize(toOther) * 0.1f / (distance * distance + 0.01f);
+				}
+				continue;
+			}
+
+			neighbors++;
+			alignmentSum += glm::normalize(other.dir);
+			cohesionSum += other.pos;
+			glm::vec2 diff = -toOther;
+			separationSum += diff / ((float)diff.length() + 0.000001f);
+		}
+
+		// Same weighting as Boid::update, per second rather than per step
+		inspection.neighbors = neighbors;
+		inspection.predators = predators;
+		inspection.friendsUsed = static_cast<int>(boid.friends.size());
+		inspection.avoidance = avoidanceSum;
+		if (neighbors > 0) {
+			glm::vec2 center = cohesionSum / static_cast<float>(neighbors) - boid.pos;
+			inspection.alignment = alignmentSum / static_cast<float>(neighbors) * alignment;
+			inspection.cohesion = center * cohesion * (boid.isPredator ? 2.0f : 1.0f);
+			inspection.separation = separationSum * separation;
+		}
+		else {
+			inspection.alignment = inspection.cohesion = inspection.separation = glm::vec2(0.0f);
+		}
+	}
+
+	void highlightSelected() {
+
+		// Only the selected boid and its neighbors are recolored, update() resets them next step
+		if (!inspection.selected || inspection.index < 0) return;
+
+		for (int id : inspectHits) Boids[id].visColor = { 0, 0, 1 };
+		Boids[inspection.index].visColor = { 1, 0, 0 };
+	}
 };
 
@@ -1,7 +1,11 @@
+#pragma once
 #include <unordered_map>
 #include <vector>
 #include <functional>
+#include <algorithm>
 #include "Boid.h"
+#include "Arena.h"
+#include "Numa.h"
 
 // Hash function for std::pair
 struct PairHash {
@@ -18,9 +22,24 @@ class SpatialGrid {
     A spatial grid data structure for efficient collision detection and spatial queries.
     This class divides 2D space into a grid of cells and allows fast retrieval of objects
     in nearby cells, which is useful for broad-phase collision detection.
+    Cell contents live in an arena that is reset on every full build, so cells that get
+    more crowded never reallocate on the heap once the arena has reached its peak size.
     */
     float cell_size;
-    std::unordered_map<std::pair<int, int>, std::vector<int>, PairHash> grid;
+    std::unordered_map<std::pair<int, int>, ScratchList<int>, PairHash> grid;
+    Arena arena{ 256 * 1024 };
+
+    // Incremental mode bookkeeping: cell each boid is filed under and its index in that cell
+    std::vector<std::pair<int, int>> boidCells;
+    std::vector<int> boidSlots;
+    std::vector<std::pair<int, int>> newCells;
+    float reservedWidth = 0.0f, reservedHeight = 0.0f;
+    std::pair<int, int> reservedLow{ 0, 0 }, reservedHigh{ 0, 0 };
+
+    // Banded builds: cells are split into one band per thread, each band has its own arena
+    std::vector<int> bandKeys;                 // first cellKey of each band
+    std::vector<Arena> bandArenas;
+    std::vector<std::vector<int>> strays;      // boids outside the band of the thread that read them, per band pair
 
 public:
     SpatialGrid(float cell_size) : cell_size(cell_size) {}
@@ -31,20 +50,268 @@ public:
                 static_cast<int>(y / cell_size) };
     }
 
+    float cellDistanceSq(std::pair<int, int> cell, glm::vec2 p) const {
+        // Squared distance from p to the area of a cell. getCell truncates towards zero,
+        // so cell 0 of each axis spans (-cell_size, cell_size).
+        float loX = (cell.first > 0 ? cell.first : cell.first - 1) * cell_size;
+        float hiX = (cell.first >= 0 ? cell.first + 1 : cell.first) * cell_size;
+        float loY = (cell.second > 0 ? cell.second : cell.second - 1) * cell_size;
+        float hiY = (cell.second >= 0 ? cell.second + 1 : cell.second) * cell_size;
+        float dx = std::max(std::max(loX - p.x, p.x - hiX), 0.0f);
+        float dy = std::max(std::max(loY - p.y, p.y - hiY), 0.0f);
+        return dx * dx + dy * dy;
+    }
+
+    float cellSize() const {
+        return cell_size;
+    }
+
+    void setCellSize(float size) {
+        // Changing the cell size invalidates every cell.
+        if (size == cell_size) return;
+        cell_size = size;
+        clear();
+    }
+
+    void reserveDomain(float halfWidth, float halfHeight) {
+        // Create every cell of [-halfWidth, halfWidth] x [-halfHeight, halfHeight] up front,
+        // so boids wandering into a cell for the first time don't allocate map nodes mid-frame.
+        if (halfWidth == reservedWidth && halfHeight == reservedHeight) return;
+        reservedWidth = halfWidth;
+        reservedHeight = halfHeight;
+
+        auto low = getCell(-halfWidth, -halfHeight);
+        auto high = getCell(halfWidth, halfHeight);
+        reservedLow = low;
+        reservedHigh = high;
+        for (int x = low.first; x <= high.first; x++) {
+            for (int y = low.second; y <= high.second; y++) cellAt({ x, y });
+        }
+    }
+
     void clear() {
         // Clear the spatial grid.
         grid.clear();
+        arena.reset();
+        reservedWidth = reservedHeight = 0.0f;
+        reservedLow = reservedHigh = { 0, 0 };
+        boidCells.clear();
+        boidSlots.clear();
+    }
+
+    void reset() {
+        // Empty every cell but keep the cells themselves for the next build.
+        arena.reset();
+        for (auto& cell : grid) cell.second.reset(&arena);
+        boidCells.clear();
+        boidSlots.clear();
+    }
+
+    void rebuild(const std::vector<Boid>& boids) {
+        // Full rebuild that also records where every boid went, so update() can move them later.
+        int numBoids = static_cast<int>(boids.size());
+        reset();
+        boidCells.resize(numBoids);
+        boidSlots.resize(numBoids);
+
+        for (int id = 0; id < numBoids; id++) {
+            auto cell = getCell(boids[id].pos.x, boids[id].pos.y);
+            ScratchList<int>& ids = cellAt(cell);
+            boidCells[id] = cell;
+            boidSlots[id] = static_cast<int>(ids.size());
+            ids.push_back(id);
+        }
+    }
+
+    int update(const std::vector<Boid>& boids, float maxMovedFraction = 0.25f) {
+        // Incremental update: only boids that crossed a cell boundary are moved.
+        // Falls back to rebuild() when the population changed or too many boids jumped,
+        // returns the number of moved boids or -1 after a rebuild.
+        int numBoids = static_cast<int>(boids.size());
+        if (numBoids != static_cast<int>(boidCells.size())) {
+            rebuild(boids);
+            return -1;
+        }
+
+        newCells.resize(numBoids);
+        int moved = 0;
+
+        #pragma omp parallel for schedule(static) reduction(+:moved)
+        for (int id = 0; id < numBoids; id++) {
+            newCells[id] = getCell(boids[id].pos.x, boids[id].pos.y);
+            if (newCells[id] != boidCells[id]) moved++;
+        }
+
+        if (moved > maxMovedFraction * numBoids) {
+            rebuild(boids);
+            return -1;
+        }
+
+        for (int id = 0; id < numBoids; id++) {
+            if (newCells[id] == boidCells[id]) continue;
+
+            // Swap-remove from the old cell, fix the slot of the boid that took our place
+            ScratchList<int>& from = cellAt(boidCells[id]);
+            int slot = boidSlots[id];
+            int last = from.back();
+            from[slot] = last;
+            boidSlots[last] = slot;
+            from.pop_back();
+
+            ScratchList<int>& to = cellAt(newCells[id]);
+            boidCells[id] = newCells[id];
+            boidSlots[id] = static_cast<int>(to.size());
+            to.push_back(id);
+        }
+
+        return moved;
+    }
+
+    int cellKey(std::pair<int, int> cell) const {
+        // Row-major index of a cell of the reserved domain, cells outside are clamped to its border
+        int cols = reservedHigh.first - reservedLow.first + 1;
+        int x = std::min(std::max(cell.first, reservedLow.first), reservedHigh.first) - reservedLow.first;
+        int y = std::min(std::max(cell.second, reservedLow.second), reservedHigh.second) - reservedLow.second;
+        return y * cols + x;
+    }
+
+    int cellKeyCount() const {
+        return (reservedHigh.first - reservedLow.first + 1) * (reservedHigh.second - reservedLow.second + 1);
+    }
+
+    void setBands(const std::vector<int>& firstKeys) {
+        // Band b owns the cells from cellKey firstKeys[b] up to the next band's first key.
+        // Keys must not decrease, empty turns bands off.
+        bandKeys.assign(firstKeys.begin(), firstKeys.end());
+        if (bandArenas.size() < bandKeys.size()) bandArenas.resize(bandKeys.size());
+        size_t lists = bandKeys.size() * (bandKeys.size() + 1);
+        if (strays.size() < lists) strays.resize(lists);
+    }
+
+    int bandCount() const {
+        return static_cast<int>(bandKeys.size());
+    }
+
+    int bandOf(std::pair<int, int> cell) const {
+        int key = cellKey(cell);
+        return static_cast<int>(std::upper_bound(bandKeys.begin() + 1, bandKeys.end(), key) - bandKeys.begin()) - 1;
+    }
+
+    void buildBanded(const std::vector<Boid>& boids) {
+        // Parallel full build. Band b files the boids of the b-th static block of indices that fall
+        // into its own cells, from its own arena, on the thread that updates that block. With boids
+        // sorted by cell (the NUMA-local mode of the Simulation) that is nearly all of them, so the
+        // cells are first touched by, and stay on the node of, the threads that read them.
+        // Boids that drifted into another band since the sort are handed to that band in a second
+        // pass, only boids in cells that don't exist yet are filed afterwards on this thread.
+        int bands = bandCount();
+        int numBoids = static_cast<int>(boids.size());
+
+        arena.reset();
+        for (int b = 0; b < bands; b++) bandArenas[b].reset();
+        for (auto& cell : grid) cell.second.reset(&bandArenas[bandOf(cell.first)]);
+        boidCells.clear();
+        boidSlots.clear();
+
+        // One band per iteration: with as many bands as threads, band b runs on thread b.
+        // Only band b writes to the cells of band b, and finding cells doesn't modify the map.
+        // strays[from * (bands + 1) + to] holds the boids band `from` found in band `to`,
+        // to == bands for boids without a cell.
+        #pragma omp parallel
+        {
+            #pragma omp for schedule(static, 1)
+            for (int b = 0; b < bands; b++) {
+                for (int to = 0; to <= bands; to++) strays[b * (bands + 1) + to].clear();
+                numa::Block block = numa::staticBlock(numBoids, bands, b);
+                for (int id = block.begin; id < block.end; id++) {
+                    auto cell = getCell(boids[id].pos.x, boids[id].pos.y);
+                    auto it = grid.find(cell);
+                    int owner = it == grid.end() ? bands : bandOf(cell);
+                    if (owner == b) it->second.push_back(id);
+                    else strays[b * (bands + 1) + owner].push_back(id);
+                }
+            }
+
+            #pragma omp for schedule(static, 1)
+            for (int b = 0; b < bands; b++) {
+                for (int from = 0; from < bands; from++) {
+                    for (int id : strays[from * (bands + 1) + b]) {
+                        grid.find(getCell(boids[id].pos.x, boids[id].pos.y))->second.push_back(id);
+                    }
+                }
+            }
+        }
+
+        for (int from = 0; from < bands; from++) {
+            for (int id : strays[from * (bands + 1) + bands]) insert(boids[id], id);
+        }
+    }
+
+    int strayCount() const {
+        // Boids the last banded build found outside the band of their block
+        size_t count = 0;
+        for (int k = 0; k < bandCount() * (bandCount() + 1); k++) count += strays[k].size();
+        return static_cast<int>(count);
     }
 
     void insert(const Boid& boid, int id) {
         // Insert a body into the appropriate cell in the grid.
         auto cell = getCell(boid.pos.x, boid.pos.y);
-        grid[cell].push_back(id);
+        cellAt(cell).push_back(id);
+    }
+
+    const std::unordered_map<std::pair<int, int>, ScratchList<int>, PairHash>& cells() const {
+        // Read-only access to the occupied cells, used to build per-cell work.
+        return grid;
+    }
+
+    int count_nearby(std::pair<int, int> cell) const {
+        // Number of bodies a query from this cell will have to check.
+        int count = 0;
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                auto it = grid.find(std::make_pair(cell.first + dx, cell.second + dy));
+                if (it != grid.end()) count += static_cast<int>(it->second.size());
+            }
+        }
+        return count;
+    }
+
+    size_t maxCellSize() const {
+        // A 3x3 query never returns more than 9x this
+        size_t most = 0;
+        for (const auto& cell : grid) most = std::max(most, cell.second.size());
+        return most;
+    }
+
+    size_t arenaPeak() const {
+        // Peak use of the cell arenas, banded ones included
+        size_t total = arena.peakBytes();
+        for (const Arena& band : bandArenas) total += band.peakBytes();
+        return total;
+    }
+
+    const ScratchList<int>* findCell(std::pair<int, int> cell) const {
+        // Read-only lookup, safe to call from many threads while nobody builds the grid.
+        auto it = grid.find(cell);
+        return it == grid.end() ? nullptr : &it->second;
+    }
+
+    ScratchList<int>& cellAt(std::pair<int, int> cell) {
+        // Cell lookup that hooks newly created cells up to the arena.
+        auto result = grid.try_emplace(cell);
+        if (result.second) result.first->second.reset(&arena);
+        return result.first->second;
     }
 
     void get_nearby(const Boid& boid, std::vector<int>& nearby) const {
         // Retrieve bodies in the same and neighboring cells for potential collision checks.
-        auto cell = getCell(boid.pos.x, boid.pos.y);
+        get_nearby(boid.pos, nearby);
+    }
+
+    void get_nearby(glm::vec2 pos, std::vector<int>& nearby) const {
+        // Same query around an arbitrary point (picking, inspection).
+        auto cell = getCell(pos.x, pos.y);
         nearby.clear();
 
         for (int dx = -1; dx <= 1; dx++) {
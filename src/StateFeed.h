@@ -0,0 +1,296 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Boid.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <time.h>
+#define BOIDS_HAS_STATE_FEED 1
+#else
+#define BOIDS_HAS_STATE_FEED 0
+#endif
+
+// Fixed layout of the shared-memory state feed (POSIX shm, shows up as /dev/shm/<name> on Linux).
+// [FeedHeader][slot 0][slot 1]...  every slot is [FeedSlotHeader][x][y][dx][dy][rgba], each array
+// `capacity` long, 64-byte aligned. Slots are versioned seqlock style: the sequence is odd while
+// the writer fills the slot and even once it's complete, a reader that sees the same even value
+// before and after reading got a consistent frame. Readers never write, so they can't slow the writer.
+namespace feed {
+
+const uint32_t magic   = 0x424f4944;   // "BOID"
+const uint32_t version = 1;
+
+struct FeedHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t capacity;
+    uint64_t slotBytes;
+    std::atomic<uint64_t> latest;      // ring number of the newest complete frame, 0 = none yet
+    char pad[32];
+};
+
+struct FeedSlotHeader {
+    std::atomic<uint64_t> sequence;
+    uint64_t number;                   // ring position of the frame in the slot, latest() counts these
+    uint64_t frame;                    // simulation step, one per substep of a rendered frame
+    uint64_t timestampNs;              // CLOCK_MONOTONIC when the frame was published
+    uint32_t count;
+    uint32_t reserved;
+    char pad[24];
+};
+
+static_assert(sizeof(FeedHeader) == 64 && sizeof(FeedSlotHeader) == 64, "feed headers are one cache line");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the feed needs address-free 64-bit atomics");
+
+inline size_t arrayBytes(uint32_t capacity) {
+    return (static_cast<size_t>(capacity) * 4 + 63) & ~static_cast<size_t>(63);
+}
+
+inline size_t slotBytes(uint32_t capacity) {
+    return sizeof(FeedSlotHeader) + 5 * arrayBytes(capacity);
+}
+
+inline uint64_t monotonicNs() {
+#if BOIDS_HAS_STATE_FEED
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+#else
+    return 0;
+#endif
+}
+
+// One frame as seen by a reader, the pointers point straight into the shared mapping
+struct FrameView {
+    uint64_t frame;
+    uint64_t timestampNs;
+    uint32_t count;
+    const float* x;
+    const float* y;
+    const float* dx;
+    const float* dy;
+    const uint32_t* rgba;
+};
+
+}
+
+class StateFeed {
+    /*
+    Writer side of the shared-memory feed. publish() copies a step's positions, headings and
+    colors into the next ring slot (in parallel) and bumps the slot's sequence around the copy.
+    Flocks bigger than the capacity are truncated to it.
+    */
+public:
+    StateFeed() = default;
+    StateFeed(const StateFeed&) = delete;
+    StateFeed& operator=(const StateFeed&) = delete;
+    ~StateFeed() { close(); }
+
+    bool open(const std::string& name, uint32_t capacity, uint32_t slots = 4) {
+#if BOIDS_HAS_STATE_FEED
+        close();
+        size_t bytes = sizeof(feed::FeedHeader) + static_cast<size_t>(slots) * feed::slotBytes(capacity);
+
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) return false;
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            ::close(fd);
+            return false;
+        }
+        void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mem == MAP_FAILED) return false;
+
+        base = static_cast<char*>(mem);
+        mappedBytes = bytes;
+        shmName = name;
+
+        header = new (base) feed::FeedHeader();
+        header->slots = slots;
+        header->capacity = capacity;
+        header->slotBytes = feed::slotBytes(capacity);
+        header->latest.store(0, std::memory_order_relaxed);
+        for (uint32_t s = 0; s < slots; s++) {
+            new (slot(s)) feed::FeedSlotHeader();
+        }
+        header->version = feed::version;
+        // Readers check the magic last, everything above is visible by then
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = feed::magic;
+        return true;
+#else
+        (void)name; (void)capacity; (void)slots;
+        return false;
+#endif
+    }
+
+    bool isOpen() const { return header != nullptr; }
+
+    void publish(const std::vector<Boid>& boids, uint64_t frame) {
+        if (!header) return;
+
+        uint64_t number = header->latest.load(std::memory_order_relaxed) + 1;
+        feed::FeedSlotHeader* target = slot(static_cast<uint32_t>(number % header->slots));
+        uint32_t capacity = header->capacity;
+        int count = static_cast<int>(std::min<size_t>(boids.size(), capacity));
+
+        // Odd: readers that catch this slot now will retry or drop it
+        uint64_t sequence = target->sequence.load(std::memory_order_relaxed);
+        target->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        char* data = reinterpret_cast<char*>(target + 1);
+        size_t stride = feed::arrayBytes(capacity);
+        float* x  = reinterpret_cast<float*>(data);
+        float* y  = reinterpret_cast<float*>(data + stride);
+        float* dx = reinterpret_cast<float*>(data + 2 * stride);
+        float* dy = reinterpret_cast<float*>(data + 3 * stride);
+        uint32_t* rgba = reinterpret_cast<uint32_t*>(data + 4 * stride);
+
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < count; i++) {
+            const Boid& b = boids[i];
+            x[i] = b.pos.x;
+            y[i] = b.pos.y;
+            dx[i] = b.dir.x;
+            dy[i] = b.dir.y;
+            glm::vec3 c = glm::clamp(b.visColor, 0.0f, 1.0f) * 255.0f;
+            rgba[i] = static_cast<uint32_t>(c.x) | static_cast<uint32_t>(c.y) << 8 | static_cast<uint32_t>(c.z) << 16 | 0xff000000u;
+        }
+
+        target->number = number;
+        target->frame = frame;
+        target->timestampNs = feed::monotonicNs();
+        target->count = static_cast<uint32_t>(count);
+
+        target->sequence.store(sequence + 2, std::memory_order_release);
+        header->latest.store(number, std::memory_order_release);
+    }
+
+    void close() {
+#if BOIDS_HAS_STATE_FEED
+        if (!base) return;
+        munmap(base, mappedBytes);
+        shm_unlink(shmName.c_str());
+        base = nullptr;
+        header = nullptr;
+#endif
+    }
+
+private:
+    char* base = nullptr;
+    size_t mappedBytes = 0;
+    std::string shmName;
+    feed::FeedHeader* header = nullptr;
+
+    feed::FeedSlotHeader* slot(uint32_t index) const {
+        return reinterpret_cast<feed::FeedSlotHeader*>(base + sizeof(feed::FeedHeader) + index * header->slotBytes);
+    }
+};
+
+class StateFeedReader {
+    /*
+    Read-only view of a feed in another process. read() hands the newest complete frame to a
+    callback straight from the mapping (no copy) and reports whether it stayed consistent:
+    if the writer lapped the slot meanwhile the callback's results have to be thrown away.
+    */
+public:
+    StateFeedReader() = default;
+    StateFeedReader(const StateFeedReader&) = delete;
+    StateFeedReader& operator=(const StateFeedReader&) = delete;
+    ~StateFeedReader() { close(); }
+
+    bool open(const std::string& name) {
+#if BOIDS_HAS_STATE_FEED
+        close();
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) return false;
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(feed::FeedHeader)) {
+            ::close(fd);
+            return false;
+        }
+        void* mem = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mem == MAP_FAILED) return false;
+
+        base = static_cast<const char*>(mem);
+        mappedBytes = static_cast<size_t>(info.st_size);
+        header = reinterpret_cast<const feed::FeedHeader*>(base);
+
+        if (header->magic != feed::magic || header->version != feed::version ||
+            sizeof(feed::FeedHeader) + header->slots * header->slotBytes > mappedBytes) {
+            close();
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    uint64_t latest() const {
+        return header ? header->latest.load(std::memory_order_acquire) : 0;
+    }
+
+    uint32_t capacity() const { return header ? header->capacity : 0; }
+
+    template <typename F>
+    bool read(uint64_t number, const F& consume) const {
+        // Reads frame `number` (as returned by latest()), false if it was torn or already overwritten
+        if (!header || number == 0) return false;
+
+        const feed::FeedSlotHeader* source = slot(static_cast<uint32_t>(number % header->slots));
+        uint64_t before = source->sequence.load(std::memory_order_acquire);
+        if ((before & 1) || source->number != number) return false;
+
+        const char* data = reinterpret_cast<const char*>(source + 1);
+        size_t stride = feed::arrayBytes(header->capacity);
+        feed::FrameView view;
+        view.frame = source->frame;
+        view.timestampNs = source->timestampNs;
+        view.count = std::min(source->count, header->capacity);
+        view.x = reinterpret_cast<const float*>(data);
+        view.y = reinterpret_cast<const float*>(data + stride);
+        view.dx = reinterpret_cast<const float*>(data + 2 * stride);
+        view.dy = reinterpret_cast<const float*>(data + 3 * stride);
+        view.rgba = reinterpret_cast<const uint32_t*>(data + 4 * stride);
+
+        consume(view);
+
+        // Any write into the slot since `before` has moved the sequence on
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return source->sequence.load(std::memory_order_relaxed) == before;
+    }
+
+    void close() {
+#if BOIDS_HAS_STATE_FEED
+        if (base) munmap(const_cast<char*>(base), mappedBytes);
+        base = nullptr;
+        header = nullptr;
+#endif
+    }
+
+private:
+    const char* base = nullptr;
+    size_t mappedBytes = 0;
+    const feed::FeedHeader* header = nullptr;
+
+    const feed::FeedSlotHeader* slot(uint32_t index) const {
+        return reinterpret_cast<const feed::FeedSlotHeader*>(base + sizeof(feed::FeedHeader) + index * header->slotBytes);
+    }
+};
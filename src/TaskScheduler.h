@@ -0,0 +1,160 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+class TaskScheduler {
+    /*
+    Small work-stealing scheduler used instead of OpenMP when the flock is very unevenly
+    distributed. Tasks are pre-assigned to per-thread deques by weight (largest first onto
+    the least loaded thread), every thread works its own deque heaviest first and, when empty,
+    steals the lightest tasks from the back of the others. The calling thread works as thread 0.
+    Queues and the job are reused between runs, so a steady run does not allocate.
+    */
+    struct WorkerQueue {
+        std::mutex m;
+        std::vector<int> tasks;     // all tasks are pushed before the run starts
+        size_t head = 0;            // owner takes from here
+        size_t tail = 0;            // thieves take from here (exclusive end)
+    };
+
+public:
+    explicit TaskScheduler(int numThreads = 0) {
+
+        if (numThreads <= 0) numThreads = static_cast<int>(std::thread::hardware_concurrency());
+        if (numThreads <= 0) numThreads = 1;
+
+        for (int i = 0; i < numThreads; i++) queues.push_back(std::make_unique<WorkerQueue>());
+        loads.resize(numThreads);
+
+        for (int i = 1; i < numThreads; i++) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ~TaskScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for (auto& w : workers) w.join();
+    }
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    int threadCount() const { return static_cast<int>(queues.size()); }
+
+    // Runs body(task, thread) for every task index, blocks until all are done.
+    template <typename F>
+    void run(const std::vector<float>& weights, const F& body) {
+
+        int numTasks = static_cast<int>(weights.size());
+        if (numTasks == 0) return;
+
+        // Type-erased without std::function, which would heap allocate bigger captures
+        jobContext = &body;
+        job = [](const void* ctx, int task, int thread) { (*static_cast<const F*>(ctx))(task, thread); };
+        remaining.store(numTasks, std::memory_order_relaxed);
+
+        // Longest-processing-time-first assignment, stealing fixes what the estimate gets wrong
+        order.resize(numTasks);
+        for (int t = 0; t < numTasks; t++) order[t] = t;
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return weights[a] > weights[b]; });
+        std::fill(loads.begin(), loads.end(), 0.0f);
+
+        for (auto& q : queues) {
+            std::lock_guard<std::mutex> lock(q->m);
+            q->tasks.clear();
+            q->head = 0;
+            q->tail = 0;
+        }
+
+        for (int t : order) {
+            int target = static_cast<int>(std::min_element(loads.begin(), loads.end()) - loads.begin());
+            loads[target] += weights[t];
+            std::lock_guard<std::mutex> lock(queues[target]->m);
+            queues[target]->tasks.push_back(t);
+            queues[target]->tail++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            generation++;
+        }
+        wake.notify_all();
+
+        work(0);
+
+        while (remaining.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+        job = nullptr;
+        jobContext = nullptr;
+    }
+
+private:
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::vector<int> order;
+    std::vector<float> loads;
+
+    void (*job)(const void*, int, int) = nullptr;
+    const void* jobContext = nullptr;
+    std::atomic<int> remaining{ 0 };
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    unsigned long long generation = 0;
+    bool stop = false;
+
+    bool popOwn(int thread, int& task) {
+        WorkerQueue& q = *queues[thread];
+        std::lock_guard<std::mutex> lock(q.m);
+        if (q.head == q.tail) return false;
+        task = q.tasks[q.head++];
+        return true;
+    }
+
+    bool steal(int thread, int& task) {
+        int numThreads = threadCount();
+        for (int k = 1; k < numThreads; k++) {
+            WorkerQueue& q = *queues[(thread + k) % numThreads];
+            std::lock_guard<std::mutex> lock(q.m);
+            if (q.head == q.tail) continue;
+            task = q.tasks[--q.tail];
+            return true;
+        }
+        return false;
+    }
+
+    void work(int thread) {
+        int task;
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (popOwn(thread, task) || steal(thread, task)) {
+                job(jobContext, task, thread);
+                remaining.fetch_sub(1, std::memory_order_acq_rel);
+            }
+            else {
+                // Everything is taken, the rest is still running on other threads
+                return;
+            }
+        }
+    }
+
+    void workerLoop(int thread) {
+        unsigned long long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                wake.wait(lock, [&] { return stop || generation != seen; });
+                if (stop) return;
+                seen = generation;
+            }
+            work(thread);
+        }
+    }
+};
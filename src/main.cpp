@@ -10,6 +10,10 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "Simulation.h"
+#include "LeanFlock.h"
+#include "QualityController.h"
+#include "StateFeed.h"
+#include "RenderLod.h"
 #include "Gui.h"
 
 // Global variables
@@ -17,7 +21,9 @@ GLuint SCR_WIDTH  = 1400;
 GLuint SCR_HEIGHT = 900;
 
 int       N             = 10000; // Number of boids
-const int maxBufferSize = 2*N; // max buffer size
+int       maxBufferSize = 2*N; // instance buffer capacity, grows and shrinks with the flock
+const int minBufferSize = 2*N; // the buffer never shrinks below its startup size
+int       shrinkFrames  = 0;   // frames the flock has been small enough to shrink the buffer
 float     scale         = 1.0f;
 
 float aspect         = (float)SCR_WIDTH / (float)SCR_HEIGHT;
@@ -28,13 +34,31 @@ float deltaTime      = 0.016f;
 float lastFrame      = 0.0f;
 bool  spawnPredators = false;
 int   spawnCount     = 1;
+float killRadius     = 0.05f;
 
 Simulation sim(N, aspect);
 GUI gui;
+QualityController quality;
+int drawnInstances = 0;   // instances uploaded this frame, fewer than the flock when the controller thins it out
+
+// Memory-lean mode for huge populations, started with --lean <count>
+bool      leanMode = false;
+LeanFlock lean;
+const int maxLeanInstances = 1 << 20;   // larger lean flocks draw every n-th boid (32 MB of instances)
+
+// Shared-memory state feed for other processes, started with --feed <name> [--feed-capacity <boids>]
+StateFeed stateFeed;
 
 // OpenGL objects
 GLFWwindow* window = nullptr;
 GLuint VAO, meshVBO, instanceVBO, shaderProgram;
+GLuint pointVAO, pointProgram;                       // point sprite LOD, same instance buffer
+GLuint densityVAO, densityProgram, densityTexture;   // density field LOD, one quad
+int    densityCols = 0, densityRows = 0;
+
+// Level of detail, picked every frame from the scale and population
+RenderLod    lod;
+DensityField density;
 
 // Mouse state tracking
 bool leftMousePressed = false;
@@ -56,6 +80,7 @@ struct BoidInstance {
 };
 
 BoidInstance* boids = new BoidInstance[N];
+int stagingSize = N;   // capacity of the boids staging array
 const char* vertexShaderSource = R"(#version 330 core
 layout (location = 0) in vec2 aLocalPos;
 layout (location = 1) in vec2 aInstancePos;
@@ -86,18 +111,68 @@ void main() {
     FragColor = vec4(Color, 1.0);
 })";
 
+// Point sprites read position and color from the instance buffer as plain vertices
+const char* pointVertexShaderSource = R"(#version 330 core
+layout (location = 1) in vec2 aInstancePos;
+layout (location = 3) in vec3 aColor;
+
+out vec3 Color;
+uniform mat4 projection;
+uniform float pointSize;
+
+void main() {
+    gl_Position = projection * vec4(aInstancePos, 0.0, 1.0);
+    gl_PointSize = pointSize;
+    Color = aColor;
+})";
+
+// One quad over the grid, corners come from gl_VertexID
+const char* densityVertexShaderSource = R"(#version 330 core
+out vec2 TexCoord;
+uniform mat4 projection;
+uniform vec2 origin;
+uniform vec2 extent;
+
+void main() {
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    gl_Position = projection * vec4(origin + corner * extent, 0.0, 1.0);
+    TexCoord = corner;
+})";
+
+const char* densityFragmentShaderSource = R"(#version 330 core
+in vec2 TexCoord;
+out vec4 FragColor;
+uniform sampler2D density;
+uniform float peak;
+
+void main() {
+    // Log scale so sparse flocks still show next to the dense core
+    float v = log(1.0 + texture(density, TexCoord).r) / log(1.0 + max(peak, 1.0));
+    vec3 background = vec3(0.1);
+    vec3 color = v < 0.5 ? mix(background, vec3(0.1, 0.45, 0.8), v * 2.0)
+                         : mix(vec3(0.1, 0.45, 0.8), vec3(1.0, 0.95, 0.8), v * 2.0 - 1.0);
+    FragColor = vec4(color, 1.0);
+})";
+
 // Function prototypes
 bool initializeOpenGL();
 bool createShaders();
 void setupBuffers();
 void updateInstanceBuffer();
 void render();
+void stepFrame();
 void cleanup();
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void cursor_position_callback(GLFWwindow* window, double xpos, double ypos);
 glm::vec2 ScreenToWorld(double xpos, double ypos);
 void updateBoidsInstanceBuffer(int newN);
+void reserveInstanceBuffer(int numBoids);
+GLuint buildProgram(const char* vertexSource, const char* fragmentSource, const char* name);
+void setProjection(const glm::mat4& projection);
+void updateDensityTexture();
+void updateLeanInstanceBuffer();
+void syncLeanParams();
 
 bool initializeOpenGL() {
     // Initialize GLFW
@@ -138,10 +213,10 @@ bool initializeOpenGL() {
     return true;
 }
 
-bool createShaders() {
+GLuint buildProgram(const char* vertexSource, const char* fragmentSource, const char* name) {
     // Vertex shader
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
+    glShaderSource(vertexShader, 1, &vertexSource, NULL);
     glCompileShader(vertexShader);
 
     // Check vertex shader compilation
@@ -150,50 +225,65 @@ bool createShaders() {
     glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
     if (!success) {
         glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cerr << "Vertex shader compilation failed: " << infoLog << std::endl;
-        return false;
+        std::cerr << name << " vertex shader compilation failed: " << infoLog << std::endl;
+        return 0;
     }
 
     // Fragment shader
     GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
+    glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
     glCompileShader(fragmentShader);
 
     // Check fragment shader compilation
     glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
     if (!success) {
         glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cerr << "Fragment shader compilation failed: " << infoLog << std::endl;
-        return false;
+        std::cerr << name << " fragment shader compilation failed: " << infoLog << std::endl;
+        return 0;
     }
 
     // Create shader program
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
 
     // Check program linking
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
     if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cerr << "Shader program linking failed: " << infoLog << std::endl;
-        return false;
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cerr << name << " shader program linking failed: " << infoLog << std::endl;
+        return 0;
     }
 
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+    return program;
+}
+
+bool createShaders() {
+    shaderProgram  = buildProgram(vertexShaderSource, fragmentShaderSource, "Boid");
+    pointProgram   = buildProgram(pointVertexShaderSource, fragmentShaderSource, "Point");
+    densityProgram = buildProgram(densityVertexShaderSource, densityFragmentShaderSource, "Density");
+    if (!shaderProgram || !pointProgram || !densityProgram) return false;
 
     // Set projection matrix
     float aspect = (float)SCR_WIDTH / (float)SCR_HEIGHT;
-    glm::mat4 projection = glm::ortho(-aspect, aspect, -1.0f, 1.0f, -1.0f, 1.0f);
+    setProjection(glm::ortho(-aspect, aspect, -1.0f, 1.0f, -1.0f, 1.0f));
 
-    glUseProgram(shaderProgram);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUseProgram(densityProgram);
+    glUniform1i(glGetUniformLocation(densityProgram, "density"), 0);
 
     return true;
 }
 
+void setProjection(const glm::mat4& projection) {
+    for (GLuint program : { shaderProgram, pointProgram, densityProgram }) {
+        glUseProgram(program);
+        glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    }
+}
+
 void setupBuffers() {
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &meshVBO);
@@ -233,6 +323,24 @@ void setupBuffers() {
     glEnableVertexAttribArray(4);
     glVertexAttribDivisor(4, 1);
 
+    // Point sprites: the same instance buffer, read per vertex
+    glGenVertexArrays(1, &pointVAO);
+    glBindVertexArray(pointVAO);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(BoidInstance), (void*)offsetof(BoidInstance, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(BoidInstance), (void*)offsetof(BoidInstance, color));
+    glEnableVertexAttribArray(3);
+
+    // Density quad has no vertex data, it only needs a VAO bound
+    glGenVertexArrays(1, &densityVAO);
+    glGenTextures(1, &densityTexture);
+    glBindTexture(GL_TEXTURE_2D, densityTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
     // Cleanup
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
@@ -244,23 +352,101 @@ void setupBuffers() {
 }
 
 void updateInstanceBuffer() {
+    size_t population = leanMode ? lean.size() : sim.Boids.size();
+    lod.preferPoints = !leanMode && quality.drawPoints();
+    lod.choose(scale, population, static_cast<int>(SCR_WIDTH), static_cast<int>(SCR_HEIGHT));
+
+    // The density field replaces the per-boid upload altogether
+    if (lod.mode == RenderLod::Density) {
+        if (leanMode) density.fromLean(lean);
+        else density.fromGrid(sim.grid, sim.aspect);
+        updateDensityTexture();
+        if (!leanMode) N = static_cast<int>(population);
+        drawnInstances = 0;
+        return;
+    }
+
+    if (leanMode) {
+        updateLeanInstanceBuffer();
+        return;
+    }
+
     int numBoids = static_cast<int>(sim.Boids.size());
 
-    if (numBoids > maxBufferSize) {
-        std::cerr << "Error: Number of boids (" << numBoids << ") exceeds buffer size (" << maxBufferSize << ")" << std::endl;
-        numBoids = maxBufferSize;
+    // Spawns and kills were applied inside sim.update()
+    N = numBoids;
+    updateBoidsInstanceBuffer(numBoids);
+    reserveInstanceBuffer(numBoids);
+
+    // The quality controller may draw only every n-th boid
+    int stride = quality.drawStride();
+    drawnInstances = 0;
+    for (int i = 0; i < numBoids; i += stride) {
+        BoidInstance& instance = boids[drawnInstances++];
+        instance.position = sim.Boids[i].pos;
+        instance.scale = scale;
+        instance.rotation = sim.Boids[i].getRotation();
+        instance.color = sim.Boids[i].visColor;
     }
 
-    for (int i = 0; i < numBoids; i++) {
-        boids[i].position = sim.Boids[i].pos;
-        boids[i].scale = scale;
-        boids[i].rotation = sim.Boids[i].getRotation();
-        boids[i].color = sim.Boids[i].visColor;
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, drawnInstances * sizeof(BoidInstance), boids);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void updateDensityTexture() {
+    glBindTexture(GL_TEXTURE_2D, densityTexture);
+    if (density.cols != densityCols || density.rows != densityRows) {
+        densityCols = density.cols;
+        densityRows = density.rows;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, densityCols, densityRows, 0, GL_RED, GL_FLOAT, density.texels.data());
+    }
+    else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, densityCols, densityRows, GL_RED, GL_FLOAT, density.texels.data());
     }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void updateLeanInstanceBuffer() {
+    // Streams the decoded flock through the N-sized staging array, so the host never holds
+    // a full-size BoidInstance copy of millions of boids. A flock larger than the instance
+    // buffer is drawn with a stride, every n-th boid in cell order.
+    size_t stride = (lean.size() + maxBufferSize - 1) / maxBufferSize;
+    size_t total = (lean.size() + stride - 1) / stride;
 
     glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, numBoids * sizeof(BoidInstance), boids);
+    for (size_t first = 0; first < total; first += N) {
+        size_t last = std::min(total, first + N);
+        BoidInstance* out = boids;
+
+        lean.decodeRange(first * stride, std::min(lean.size(), last * stride), [&](glm::vec2 pos, float rotation, glm::vec3 color) {
+            out->position = pos;
+            out->rotation = rotation;
+            out->color = color;
+            out->scale = scale;
+            out++;
+        }, stride);
+
+        glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(BoidInstance), (last - first) * sizeof(BoidInstance), boids);
+    }
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    drawnInstances = static_cast<int>(total);
+}
+
+void syncLeanParams() {
+    // The ImGui panel edits sim, the lean flock follows it (except for its own fov radius)
+    lean.aspect     = sim.aspect;
+    lean.fov        = sim.fov;
+    lean.alignment  = sim.alignment;
+    lean.cohesion   = sim.cohesion;
+    lean.separation = sim.separation;
+    lean.maxSpeed   = sim.maxSpeed;
+    lean.minSpeed   = sim.minSpeed;
+    lean.bounce     = sim.bounce;
+    lean.atract     = sim.atract;
+    lean.repel      = sim.repel;
+    lean.mousePoint = sim.mousePoint;
+    lean.mouseRadius = sim.mouseRadius;
 }
 
 void render() {
@@ -283,18 +469,87 @@ void render() {
     glClearColor(0.1f, 0.1f, 0.1f, 0.1f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    glUseProgram(shaderProgram);
-    glBindVertexArray(VAO);
+    // Never draw more instances than were uploaded
+    GLsizei instances = static_cast<GLsizei>(std::min(drawnInstances, maxBufferSize));
 
-    // Single instanced draw call for all boids
-    glDrawArraysInstanced(GL_TRIANGLES, 0, 3, sim.Boids.size());
+    if (lod.mode == RenderLod::Triangles) {
+        // Single instanced draw call for all boids
+        glUseProgram(shaderProgram);
+        glBindVertexArray(VAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 3, instances);
+    }
+    else {
+        // Sub-pixel boids gain nothing from 8x MSAA, it only costs bandwidth
+        glDisable(GL_MULTISAMPLE);
+        if (lod.mode == RenderLod::Points) {
+            glEnable(GL_PROGRAM_POINT_SIZE);
+            glUseProgram(pointProgram);
+            glUniform1f(glGetUniformLocation(pointProgram, "pointSize"), lod.pointSize);
+            glBindVertexArray(pointVAO);
+            glDrawArrays(GL_POINTS, 0, instances);
+        }
+        else {
+            glDisable(GL_BLEND);
+            glUseProgram(densityProgram);
+            glUniform2f(glGetUniformLocation(densityProgram, "origin"), density.origin.x, density.origin.y);
+            glUniform2f(glGetUniformLocation(densityProgram, "extent"), density.cols * density.cellSize, density.rows * density.cellSize);
+            glUniform1f(glGetUniformLocation(densityProgram, "peak"), density.peak);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, densityTexture);
+            glBindVertexArray(densityVAO);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            glEnable(GL_BLEND);
+        }
+        glEnable(GL_MULTISAMPLE);
+    }
+    glBindVertexArray(0);
 	gui.renderImgui(sim);
 
 
     glfwSwapBuffers(window);
 }
 
-int main() {
+int main(int argc, char** argv) {
+
+    std::string feedName;
+    uint32_t    feedCapacity = 1 << 20;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--lean" && i + 1 < argc) {
+            leanMode = true;
+            lean.setup(static_cast<size_t>(std::stoull(argv[++i])), aspect);
+            maxBufferSize = static_cast<int>(std::min(lean.size(), static_cast<size_t>(maxLeanInstances)));
+        }
+        else if (std::string(argv[i]) == "--feed" && i + 1 < argc) {
+            feedName = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--feed-capacity" && i + 1 < argc) {
+            feedCapacity = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (std::string(argv[i]) == "--scene" && i + 1 < argc) {
+            // Force field emitters, see ForceField::load for the format
+            std::string scene = argv[++i];
+            if (!sim.forceField.load(scene)) std::cout << "Failed to load scene " << scene << std::endl;
+        }
+        else if (std::string(argv[i]) == "--numa") {
+            // NUMA-local placement, the boids move to their threads' nodes on the first step
+            sim.numaLocal = true;
+        }
+        else if (std::string(argv[i]) == "--pin" && i + 1 < argc) {
+            // compact, spread or a cpu list, only used with --numa
+            sim.pinning = argv[++i];
+            if (numa::pinOrder(sim.pinning).empty()) {
+                std::cout << "Invalid pinning " << sim.pinning << std::endl;
+                sim.pinning.clear();
+            }
+        }
+    }
+
+    if (!feedName.empty()) {
+        if (leanMode) std::cout << "The state feed isn't available in lean mode" << std::endl;
+        else if (!stateFeed.open(feedName, feedCapacity)) std::cout << "Failed to open state feed " << feedName << std::endl;
+    }
+
     if (!initializeOpenGL()) return -1;
     if (!gui.initializeImGUI()) return -1;
     if (!createShaders()) return -1;
@@ -309,9 +564,7 @@ int main() {
         if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
             glfwSetWindowShouldClose(window, true);
 
-        sim.update(deltaTime);
-        updateInstanceBuffer();
-        render();
+        stepFrame();
     }
 
     cleanup();
@@ -325,15 +578,41 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
 
     // Update projection matrix
     aspect = float(width) / float(height);
-    glm::mat4 projection = glm::ortho(-aspect, aspect, -1.0f, 1.0f, -1.0f, 1.0f);
     sim.updateAspect(aspect);
+    setProjection(glm::ortho(-aspect, aspect, -1.0f, 1.0f, -1.0f, 1.0f));
+
+    // Keep animating while the window is dragged, the same frame as the main loop
+    stepFrame();
+}
+
+void stepFrame() {
 
-    glUseProgram(shaderProgram);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    double frameStart = glfwGetTime();
+    float simMs = 0.0f;
 
-    sim.update(deltaTime);
+    if (leanMode) {
+        syncLeanParams();
+        lean.step(deltaTime);
+    }
+    else {
+        // The controller picks substeps and neighbor settings, then learns from what this frame cost
+        quality.apply(sim);
+        int substeps = quality.substeps();
+        for (int s = 0; s < substeps; s++) {
+            sim.update(deltaTime / substeps);
+            simMs += sim.phaseMs.total;
+            // Every step goes out, readers see consecutive frame numbers also with substeps
+            stateFeed.publish(sim.Boids, static_cast<uint64_t>(sim.frameCount));
+        }
+    }
     updateInstanceBuffer();
     render();
+
+    // Frame and simulation time of this same frame, swap included
+    if (!leanMode) {
+        float frameMs = static_cast<float>((glfwGetTime() - frameStart) * 1000.0);
+        quality.observe(frameMs, simMs, static_cast<int>(sim.Boids.size()));
+    }
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
@@ -345,7 +624,13 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 
 
             if (button == GLFW_MOUSE_BUTTON_LEFT) {
-                if (action == GLFW_PRESS) {
+                if (action == GLFW_PRESS && (mods & GLFW_MOD_CONTROL) && sim.friendVisual && !leanMode) {
+                    // Pick a boid for the neighbor inspector instead of attracting
+                    double xpos, ypos;
+                    glfwGetCursorPos(window, &xpos, &ypos);
+                    sim.selectBoid(ScreenToWorld(xpos, ypos));
+                }
+                else if (action == GLFW_PRESS) {
                     leftMousePressed = true;
                     // Update mouse position immediately when pressed
                     double xpos, ypos;
@@ -374,18 +659,15 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
             }
 
 
-            if (button == GLFW_MOUSE_BUTTON_MIDDLE) {
+            if (button == GLFW_MOUSE_BUTTON_MIDDLE && !leanMode) {
                 if (action == GLFW_PRESS) {
                     double xpos, ypos;
                     glfwGetCursorPos(window, &xpos, &ypos);
                     sim.mousePoint = ScreenToWorld(xpos, ypos);
 
-                    for (int i = 0; i < spawnCount; i++) {
-                        sim.Boids.push_back(sim.generateBoid(sim.mousePoint, spawnPredators));
-                    }
-
-                    N = static_cast<int>(sim.Boids.size());
-                    updateBoidsInstanceBuffer(N);
+                    // Queued, the simulation applies it between two steps
+                    if (mods & GLFW_MOD_SHIFT) sim.commands.kill(sim.mousePoint, killRadius);
+                    else sim.commands.spawn(sim.mousePoint, spawnCount, spawnPredators);
 
                     middleMousePressed = true;
                 }
@@ -399,9 +681,42 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 
 }
 
+void reserveInstanceBuffer(int numBoids) {
+    // Grows the instance VBO before it is full and shrinks it once the flock stayed small for a while.
+    // The whole buffer is re-uploaded every frame, so resizing is an orphaning glBufferData without a copy,
+    // and the VAO keeps pointing at the same buffer object.
+    int capacity = maxBufferSize;
+
+    if (numBoids > capacity * 3 / 4) {
+        capacity = std::max(numBoids * 2, capacity * 2);
+        shrinkFrames = 0;
+    }
+    else if (numBoids < capacity / 4 && capacity > minBufferSize) {
+        // Hysteresis: a flock oscillating around a threshold must not reallocate every frame
+        if (++shrinkFrames >= 120) {
+            capacity = std::max(numBoids * 2, minBufferSize);
+            shrinkFrames = 0;
+        }
+    }
+    else {
+        shrinkFrames = 0;
+    }
+
+    if (capacity == maxBufferSize) return;
+
+    maxBufferSize = capacity;
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(maxBufferSize) * sizeof(BoidInstance), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 void updateBoidsInstanceBuffer(int newN) {
+    // Grows the staging array geometrically, never shrinks it
+    if (newN <= stagingSize) return;
+
+    stagingSize = std::max(newN, stagingSize * 2);
     delete[] boids;
-    boids = new BoidInstance[N];
+    boids = new BoidInstance[stagingSize];
 }
 
 void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
@@ -425,14 +740,20 @@ glm::vec2 ScreenToWorld(double xpos, double ypos) {
 }
 
 void cleanup() {
+    stateFeed.close();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
     delete[] boids;
     glDeleteVertexArrays(1, &VAO);
+    glDeleteVertexArrays(1, &pointVAO);
+    glDeleteVertexArrays(1, &densityVAO);
+    glDeleteTextures(1, &densityTexture);
     glDeleteBuffers(1, &meshVBO);
     glDeleteBuffers(1, &instanceVBO);
     glDeleteProgram(shaderProgram);
+    glDeleteProgram(pointProgram);
+    glDeleteProgram(densityProgram);
     glfwDestroyWindow(window);
     glfwTerminate();
 }
\ No newline at end of file
@@ -0,0 +1,208 @@
+// Headless benchmark for the simulation step.
+// Built with -DBOIDS_BUILD_BENCHMARK=ON, counts heap allocations through a global operator new
+// hook and fails when a measured frame allocates.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include "Simulation.h"
+#include "LeanFlock.h"
+
+static std::atomic<long long> allocCount{ 0 };
+static std::atomic<long long> allocBytes{ 0 };
+
+void* operator new(std::size_t size) {
+	allocCount.fetch_add(1, std::memory_order_relaxed);
+	allocBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+// Kept out of line: inlined into a caller of operator new, GCC sees new paired with free()
+// and warns (-Wmismatched-new-delete), although both ends are replaced here
+#if defined(__GNUC__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+BENCH_NOINLINE void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+
+struct BenchOptions {
+	int   boids       = 10000;
+	int   warmup      = 300;
+	int   settle      = 300;    // steps after warmup in which growth to a new scratch peak may allocate
+	unsigned int seed = 1;
+	int   steps       = 300;
+	float dt          = 0.016f;
+	bool  incremental = false;
+	bool  scheduler   = false;
+	bool  farField    = false;
+	int   topological = 0;      // k of the topological mode, 0 = metric friends
+	bool  allowAllocs = false;
+	bool  lean        = false;
+	float radius      = 0.0f;   // 0 keeps the default of the chosen mode
+	int   emitters    = 0;      // force field emitters scattered over the world
+};
+
+static void printUsage() {
+	std::printf(
+		"usage: BoidsBench [options]\n"
+		"  --boids N        population (default 10000)\n"
+		"  --warmup N       steps before measuring (default 300)\n"
+		"  --settle N       steps after warmup in which frames at a new scratch peak may allocate (default 300)\n"
+		"  --seed S         flock seed, 0 = random (default 1)\n"
+		"  --steps N        measured steps (default 300)\n"
+		"  --incremental    incremental grid\n"
+		"  --scheduler      work-stealing scheduler instead of OpenMP\n"
+		"  --farfield       Barnes-Hut far field\n"
+		"  --topological K  follow only the K closest visible neighbors\n"
+		"  --lean           memory-lean LeanFlock instead of Simulation, prints memory per boid\n"
+		"  --radius R       fov radius\n"
+		"  --emitters N     N force field emitters (attractors, repellers, vortices)\n"
+		"  --allow-allocs   report allocations but don't fail on them\n");
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& opt) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--boids" && hasValue) opt.boids = std::atoi(argv[++i]);
+		else if (arg == "--warmup" && hasValue) opt.warmup = std::atoi(argv[++i]);
+		else if (arg == "--settle" && hasValue) opt.settle = std::atoi(argv[++i]);
+		else if (arg == "--seed" && hasValue) opt.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		else if (arg == "--steps" && hasValue) opt.steps = std::atoi(argv[++i]);
+		else if (arg == "--incremental") opt.incremental = true;
+		else if (arg == "--scheduler") opt.scheduler = true;
+		else if (arg == "--farfield") opt.farField = true;
+		else if (arg == "--topological" && hasValue) opt.topological = std::atoi(argv[++i]);
+		else if (arg == "--allow-allocs") opt.allowAllocs = true;
+		else if (arg == "--lean") opt.lean = true;
+		else if (arg == "--radius" && hasValue) opt.radius = static_cast<float>(std::atof(argv[++i]));
+		else if (arg == "--emitters" && hasValue) opt.emitters = std::atoi(argv[++i]);
+		else {
+			printUsage();
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+
+	BenchOptions opt;
+	if (!parseOptions(argc, argv, opt)) return 2;
+
+	float aspect = 1400.0f / 900.0f;
+	Simulation sim;
+	LeanFlock lean;
+
+	if (opt.lean) {
+		if (opt.radius > 0.0f) lean.fovRadius = opt.radius;
+		lean.setup(static_cast<size_t>(opt.boids), aspect);
+	}
+	else {
+		sim.aspect = aspect;
+		sim.seed = opt.seed;
+		sim.setupSimulation(opt.boids);
+		if (opt.radius > 0.0f) sim.fovRadius = opt.radius;
+		sim.incrementalGrid  = opt.incremental;
+		sim.useTaskScheduler = opt.scheduler;
+		sim.farField         = opt.farField;
+		sim.topological      = opt.topological > 0;
+		sim.topologicalK     = opt.topological;
+		sim.forceField.scatter(opt.emitters, aspect, 1);
+	}
+
+	auto step = [&]() {
+		if (opt.lean) lean.step(opt.dt);
+		else sim.update(opt.dt);
+	};
+
+	for (int i = 0; i < opt.warmup; i++) step();
+
+	// Flocks keep merging long after warmup, and friend lists and query buffers grow with the
+	// densest cluster. Scratch storage grows only in a frame that sets a new peak (or in the reset
+	// right after one); during the settle steps such frames may allocate, any other frame fails.
+	// Once measuring, every allocating frame fails, peak or not. The lean flock has no settle.
+	size_t scratchPeak = opt.lean ? 0 : sim.scratchPeak();
+	size_t cellPeak    = opt.lean ? 0 : sim.grid.maxCellSize();
+	bool   lastPeaked  = false;
+
+	// Steps once and reports whether the frame allocated, and whether it did at a new peak
+	auto trackedStep = [&](bool& atPeak) {
+		long long frameStart = allocCount.load();
+		step();
+		bool peaked = false;
+		if (!opt.lean) {
+			size_t scratch = sim.scratchPeak(), cell = sim.grid.maxCellSize();
+			peaked = scratch > scratchPeak || cell > cellPeak;
+			scratchPeak = std::max(scratchPeak, scratch);
+			cellPeak = std::max(cellPeak, cell);
+		}
+		atPeak = peaked || lastPeaked;
+		lastPeaked = peaked;
+		return allocCount.load() != frameStart;
+	};
+
+	long long settleFrames = 0, settleStrayFrames = 0;
+	int settleSteps = opt.lean ? 0 : opt.settle;
+	for (int i = 0; i < settleSteps; i++) {
+		bool atPeak = false;
+		if (!trackedStep(atPeak)) continue;
+		if (atPeak) settleFrames++;
+		else settleStrayFrames++;
+	}
+
+	long long allocsBefore = allocCount.load();
+	long long bytesBefore  = allocBytes.load();
+	long long framesWithAllocs = 0, peakFrameAllocs = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < opt.steps; i++) {
+		bool atPeak = false;
+		if (!trackedStep(atPeak)) continue;
+		framesWithAllocs++;
+		if (atPeak) peakFrameAllocs++;
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	long long allocs = allocCount.load() - allocsBefore;
+	long long bytes  = allocBytes.load() - bytesBefore;
+	double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+	std::printf("boids %d, threads %d, steps %d\n", opt.boids, omp_get_max_threads(), opt.steps);
+	std::printf("step time    %.3f ms\n", ms / opt.steps);
+	if (settleSteps > 0) {
+		std::printf("settle       %lld of %d frames grew to a new scratch peak, %lld allocated without one\n",
+			settleFrames, settleSteps, settleStrayFrames);
+	}
+	std::printf("allocations  %lld (%lld bytes) in %lld of %d frames, %lld of them at a new scratch peak\n",
+		allocs, bytes, framesWithAllocs, opt.steps, peakFrameAllocs);
+
+	if (opt.lean) {
+		LeanFlock::MemoryReport report = lean.memoryReport();
+		std::printf("memory       %.1f MB total, %.2f bytes/boid (state %.1f MB, scratch %.1f MB, grid %.1f MB)\n",
+			report.totalBytes / 1048576.0, report.bytesPerBoid, report.stateBytes / 1048576.0,
+			report.scratchBytes / 1048576.0, report.gridBytes / 1048576.0);
+		std::printf("             sizeof(Boid) alone is %zu bytes, before friend lists and render staging\n", sizeof(Boid));
+	}
+
+	if ((framesWithAllocs > 0 || settleStrayFrames > 0) && !opt.allowAllocs) {
+		std::fprintf(stderr, "FAIL: %s allocated\n", framesWithAllocs > 0 ? "measured frames" : "settle frames below the scratch peak");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,277 @@
+// Multi-process domain decomposition of the flock (Linux only).
+// The [-aspect-0.1, aspect+0.1] x range is cut into one strip per process. Every step each process
+// updates the boids it owns, then publishes halos (boids within fovRadius of another strip) and
+// migrants (boids that left its strip) through shared memory, one barrier per step.
+// Runs are checked against a single-process Simulation with the same seed and a scaling report
+// over process counts is printed.
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Simulation.h"
+
+struct DomainOptions {
+	int      boids    = 20000;
+	int      steps    = 200;
+	int      maxProcs = 4;
+	unsigned seed     = 1234;
+	float    dt       = 0.016f;
+	float    aspect   = 1400.0f / 900.0f;
+};
+
+struct BoidRecord {
+	unsigned int id;
+	int          dest;
+	int          migrant;   // 1 = ownership moves to dest, 0 = halo copy
+	int          isPredator;
+	glm::vec2    pos;
+	glm::vec2    dir;
+	glm::vec3    color;
+};
+
+struct SharedHeader {
+	pthread_barrier_t barrier;
+	double stepSeconds;
+	int    overflow;
+	int    counts[64][2];
+};
+
+// Everything lives in one anonymous shared mapping created before fork
+struct SharedLayout {
+	SharedHeader* header;
+	BoidRecord*   regions;    // [procs][2][capacity]
+	BoidRecord*   finals;     // [boids], indexed by id
+	size_t        capacity;
+	size_t        bytes;
+};
+
+static BoidRecord* region(const SharedLayout& shm, int rank, int parity) {
+	return shm.regions + (static_cast<size_t>(rank) * 2 + parity) * shm.capacity;
+}
+
+static float stripWidth(const DomainOptions& opt, int procs) {
+	return 2.0f * (opt.aspect + 0.1f) / procs;
+}
+
+static int ownerOf(const DomainOptions& opt, int procs, float x) {
+	int owner = static_cast<int>(std::floor((x + opt.aspect + 0.1f) / stripWidth(opt, procs)));
+	return std::min(std::max(owner, 0), procs - 1);
+}
+
+static bool inHalo(const DomainOptions& opt, int procs, int rank, float x, float radius) {
+	float lo = -opt.aspect - 0.1f + rank * stripWidth(opt, procs);
+	float hi = lo + stripWidth(opt, procs);
+	return x >= lo - radius && x < hi + radius;
+}
+
+static BoidRecord toRecord(const Boid& b, int dest, int migrant) {
+	return { b.id, dest, migrant, b.isPredator ? 1 : 0, b.pos, b.dir, b.color };
+}
+
+static Boid fromRecord(const BoidRecord& r) {
+	Boid b(r.pos, r.dir, r.color, r.isPredator != 0);
+	b.id = r.id;
+	return b;
+}
+
+static void runWorker(int rank, int procs, const DomainOptions& opt, const Simulation& init, const SharedLayout& shm) {
+
+	omp_set_num_threads(1);
+
+	Simulation local;
+	local.aspect = opt.aspect;
+	local.seed = opt.seed;
+	float radius = local.fovRadius;
+
+	std::vector<Boid> own, halo, leaving;
+	for (const Boid& b : init.Boids) {
+		int owner = ownerOf(opt, procs, b.pos.x);
+		if (owner == rank) own.push_back(b);
+		else if (inHalo(opt, procs, rank, b.pos.x, radius)) halo.push_back(b);
+	}
+
+	std::vector<char> isOwn;
+	auto start = std::chrono::steady_clock::now();
+
+	for (int step = 0; step < opt.steps; step++) {
+		int parity = step & 1;
+
+		// Local flock sorted by id, so friend lists fill in the same order as in the single-process run
+		local.Boids.clear();
+		local.Boids.insert(local.Boids.end(), own.begin(), own.end());
+		local.Boids.insert(local.Boids.end(), halo.begin(), halo.end());
+		std::sort(local.Boids.begin(), local.Boids.end(), [](const Boid& a, const Boid& b) { return a.id < b.id; });
+
+		isOwn.assign(local.Boids.size(), 0);
+		for (size_t i = 0; i < local.Boids.size(); i++) {
+			isOwn[i] = ownerOf(opt, procs, local.Boids[i].pos.x) == rank;
+		}
+
+		// Same sequence as Simulation::update, halo boids are only read
+		local.frameCount = step + 1;
+		local.optimizedMadeFriends();
+		BoidParams params = local.boidParams(opt.dt);
+
+		for (size_t i = 0; i < local.Boids.size(); i++) {
+			if (!isOwn[i]) continue;
+			local.Boids[i].update(params);
+		}
+
+		// Publish migrants and halos
+		BoidRecord* out = region(shm, rank, parity);
+		size_t count = 0;
+		own.clear();
+		leaving.clear();
+
+		for (size_t i = 0; i < local.Boids.size(); i++) {
+			if (!isOwn[i]) continue;
+			const Boid& b = local.Boids[i];
+			int dest = ownerOf(opt, procs, b.pos.x);
+
+			if (dest == rank) own.push_back(b);
+			else {
+				if (count < shm.capacity) out[count++] = toRecord(b, dest, 1);
+				else shm.header->overflow = 1;
+				// Just crossed over, still our halo next step
+				if (inHalo(opt, procs, rank, b.pos.x, radius)) leaving.push_back(b);
+			}
+
+			for (int q = 0; q < procs; q++) {
+				if (q == rank || q == dest || !inHalo(opt, procs, q, b.pos.x, radius)) continue;
+				if (count < shm.capacity) out[count++] = toRecord(b, q, 0);
+				else shm.header->overflow = 1;
+			}
+		}
+		shm.header->counts[rank][parity] = static_cast<int>(count);
+
+		pthread_barrier_wait(&shm.header->barrier);
+
+		// Collect what the others addressed to us
+		halo.swap(leaving);
+		for (int q = 0; q < procs; q++) {
+			if (q == rank) continue;
+			const BoidRecord* in = region(shm, q, parity);
+			int n = shm.header->counts[q][parity];
+			for (int k = 0; k < n; k++) {
+				if (in[k].dest != rank) continue;
+				if (in[k].migrant) own.push_back(fromRecord(in[k]));
+				else halo.push_back(fromRecord(in[k]));
+			}
+		}
+	}
+
+	if (rank == 0) {
+		shm.header->stepSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / opt.steps;
+	}
+
+	for (const Boid& b : own) shm.finals[b.id] = toRecord(b, rank, 0);
+}
+
+static bool runDecomposed(int procs, const DomainOptions& opt, const Simulation& init, const SharedLayout& shm) {
+
+	pthread_barrierattr_t attr;
+	pthread_barrierattr_init(&attr);
+	pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_barrier_init(&shm.header->barrier, &attr, procs);
+	pthread_barrierattr_destroy(&attr);
+	shm.header->overflow = 0;
+
+	std::vector<pid_t> children;
+	for (int rank = 0; rank < procs; rank++) {
+		pid_t pid = fork();
+		if (pid == 0) {
+			runWorker(rank, procs, opt, init, shm);
+			_exit(0);
+		}
+		children.push_back(pid);
+	}
+
+	bool ok = true;
+	for (pid_t pid : children) {
+		int status = 0;
+		waitpid(pid, &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ok = false;
+	}
+
+	pthread_barrier_destroy(&shm.header->barrier);
+	return ok && !shm.header->overflow;
+}
+
+int main(int argc, char** argv) {
+
+	DomainOptions opt;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--boids" && hasValue) opt.boids = std::atoi(argv[++i]);
+		else if (arg == "--steps" && hasValue) opt.steps = std::atoi(argv[++i]);
+		else if (arg == "--procs" && hasValue) opt.maxProcs = std::min(std::atoi(argv[++i]), 64);
+		else if (arg == "--seed" && hasValue) opt.seed = static_cast<unsigned>(std::atoi(argv[++i]));
+		else {
+			std::printf("usage: BoidsDomain [--boids N] [--steps N] [--procs MAX] [--seed S]\n");
+			return 2;
+		}
+	}
+
+	// No OpenMP in the parent before forking, the reference run happens after all children are done
+	Simulation init(opt.boids, opt.aspect, opt.seed);
+
+	SharedLayout shm;
+	shm.capacity = static_cast<size_t>(opt.boids);
+	shm.bytes = sizeof(SharedHeader) + sizeof(BoidRecord) * (static_cast<size_t>(opt.maxProcs) * 2 * shm.capacity + opt.boids);
+	void* mem = mmap(nullptr, shm.bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED) {
+		std::perror("mmap");
+		return 1;
+	}
+	shm.header = static_cast<SharedHeader*>(mem);
+	shm.regions = reinterpret_cast<BoidRecord*>(shm.header + 1);
+	shm.finals = shm.regions + static_cast<size_t>(opt.maxProcs) * 2 * shm.capacity;
+
+	struct RunResult { int procs; double stepMs; std::vector<BoidRecord> finals; };
+	std::vector<RunResult> runs;
+
+	for (int procs = 1; procs <= opt.maxProcs; procs *= 2) {
+		if (!runDecomposed(procs, opt, init, shm)) {
+			std::fprintf(stderr, "run with %d processes failed (exchange buffer overflow or worker crash)\n", procs);
+			return 1;
+		}
+		runs.push_back({ procs, shm.header->stepSeconds * 1000.0, std::vector<BoidRecord>(shm.finals, shm.finals + opt.boids) });
+	}
+	munmap(mem, shm.bytes);
+
+	omp_set_num_threads(1);
+	Simulation reference(opt.boids, opt.aspect, opt.seed);   // same seed -> same initial flock as init
+	for (int step = 0; step < opt.steps; step++) reference.update(opt.dt);
+
+	std::printf("boids %d, steps %d, seed %u\n", opt.boids, opt.steps, opt.seed);
+	std::printf("%6s %12s %9s %11s %14s\n", "procs", "ms/step", "speedup", "efficiency", "max pos error");
+
+	bool match = true;
+	for (const RunResult& run : runs) {
+		float maxError = 0.0f;
+		for (const Boid& b : reference.Boids) {
+			maxError = std::max(maxError, glm::length(run.finals[b.id].pos - b.pos));
+		}
+		if (maxError > 1e-5f) match = false;
+
+		double speedup = runs[0].stepMs / run.stepMs;
+		std::printf("%6d %12.3f %9.2f %10.0f%% %14.3g\n", run.procs, run.stepMs, speedup, 100.0 * speedup / run.procs, maxError);
+	}
+
+	if (!match) {
+		std::fprintf(stderr, "FAIL: decomposed runs diverged from the single-process Simulation\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,199 @@
+// Reference reader for the shared-memory state feed (StateFeed.h), built with -DBOIDS_BUILD_FEED=ON.
+// Reader mode maps a running feed read-only and reports delivered frames, dropped and torn frames,
+// bandwidth and publish-to-read latency. Serve mode publishes a synthetic flock at a fixed rate so the
+// feed can be measured without the window, e.g. in two shells:
+//   BoidsFeedReader --serve 1000000 --rate 60
+//   BoidsFeedReader --seconds 10
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "StateFeed.h"
+
+struct FeedOptions {
+	std::string name    = "/boids_feed";
+	int         serve   = 0;       // boids to publish, 0 = read
+	float       rate    = 60.0f;   // publish rate of the synthetic writer
+	float       seconds = 10.0f;
+	int         slots   = 4;
+};
+
+static int serve(const FeedOptions& opt) {
+
+	StateFeed feed;
+	if (!feed.open(opt.name, static_cast<uint32_t>(opt.serve), static_cast<uint32_t>(opt.slots))) {
+		std::printf("could not create feed %s\n", opt.name.c_str());
+		return 1;
+	}
+
+	// Boids on concentric rings turning at different speeds, enough to see motion on the reader side
+	std::vector<Boid> boids;
+	boids.reserve(opt.serve);
+	for (int i = 0; i < opt.serve; i++) {
+		float radius = 0.05f + 0.9f * (i % 1000) / 1000.0f;
+		float angle = 6.2831853f * i / opt.serve;
+		Boid b({ radius * std::cos(angle), radius * std::sin(angle) }, { -std::sin(angle), std::cos(angle) });
+		b.visColor = { radius, 0.5f, 1.0f - radius };
+		boids.push_back(b);
+	}
+
+	float turnSin[8], turnCos[8];
+	for (int k = 0; k < 8; k++) {
+		turnSin[k] = std::sin(0.01f * (k + 1));
+		turnCos[k] = std::cos(0.01f * (k + 1));
+	}
+
+	auto period = std::chrono::duration<double>(1.0 / opt.rate);
+	auto start = std::chrono::steady_clock::now();
+	auto next = start;
+	double publishMs = 0.0, worstMs = 0.0;
+	uint64_t frame = 0;
+
+	std::printf("serving %d boids on %s at %.0f Hz for %.0f s\n", opt.serve, opt.name.c_str(), opt.rate, opt.seconds);
+	while (std::chrono::steady_clock::now() - start < std::chrono::duration<double>(opt.seconds)) {
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < opt.serve; i++) {
+			Boid& b = boids[i];
+			float s = turnSin[i & 7], c = turnCos[i & 7];
+			b.pos = { c * b.pos.x - s * b.pos.y, s * b.pos.x + c * b.pos.y };
+			b.dir = { c * b.dir.x - s * b.dir.y, s * b.dir.x + c * b.dir.y };
+		}
+
+		auto t0 = std::chrono::steady_clock::now();
+		feed.publish(boids, ++frame);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		publishMs += ms;
+		worstMs = std::max(worstMs, ms);
+
+		next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+		std::this_thread::sleep_until(next);
+	}
+
+	std::printf("published %llu frames, publish %.3f ms mean, %.3f ms worst\n",
+		static_cast<unsigned long long>(frame), publishMs / std::max<uint64_t>(frame, 1), worstMs);
+	return 0;
+}
+
+struct FrameSummary {
+	glm::vec2 centroid = { 0, 0 };
+	glm::vec2 heading  = { 0, 0 };
+	float     red      = 0.0f;
+};
+
+static FrameSummary summarize(const feed::FrameView& view) {
+	double sx = 0.0, sy = 0.0, hx = 0.0, hy = 0.0, red = 0.0;
+	int count = static_cast<int>(view.count);
+	#pragma omp parallel for schedule(static) reduction(+:sx, sy, hx, hy, red)
+	for (int i = 0; i < count; i++) {
+		sx += view.x[i];
+		sy += view.y[i];
+		hx += view.dx[i];
+		hy += view.dy[i];
+		red += view.rgba[i] & 0xff;
+	}
+
+	FrameSummary summary;
+	if (count == 0) return summary;
+	summary.centroid = { static_cast<float>(sx / count), static_cast<float>(sy / count) };
+	summary.heading  = { static_cast<float>(hx / count), static_cast<float>(hy / count) };
+	summary.red      = static_cast<float>(red / count);
+	return summary;
+}
+
+static int read(const FeedOptions& opt) {
+
+	// The writer may still be starting up
+	StateFeedReader feed;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (!feed.open(opt.name)) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			std::printf("no feed at %s\n", opt.name.c_str());
+			return 1;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+
+	std::vector<double> latencyUs;
+	uint64_t last = feed.latest(), delivered = 0, dropped = 0, torn = 0, boidCount = 0;
+	double readMs = 0.0;
+	FrameSummary lastSummary;
+
+	auto start = std::chrono::steady_clock::now();
+	while (std::chrono::steady_clock::now() - start < std::chrono::duration<double>(opt.seconds)) {
+		uint64_t number = feed.latest();
+		if (number == last) {
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+			continue;
+		}
+		if (last != 0 && number > last + 1) dropped += number - last - 1;
+		last = number;
+
+		// Touch every boid like a real consumer would: centroid, mean heading and color
+		uint64_t count = 0;
+		double latency = 0.0;
+		FrameSummary summary;
+		auto t0 = std::chrono::steady_clock::now();
+		bool consistent = feed.read(number, [&](const feed::FrameView& view) {
+			latency = (feed::monotonicNs() - view.timestampNs) / 1000.0;
+			count = view.count;
+			summary = summarize(view);
+		});
+		readMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+		if (!consistent) {
+			// The writer lapped the slot while it was being read
+			torn++;
+			continue;
+		}
+		latencyUs.push_back(latency);
+		delivered++;
+		boidCount += count;
+		lastSummary = summary;
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (latencyUs.empty()) {
+		std::printf("no frames received from %s\n", opt.name.c_str());
+		return 1;
+	}
+	std::sort(latencyUs.begin(), latencyUs.end());
+	auto percentile = [&](double p) { return latencyUs[static_cast<size_t>(p * (latencyUs.size() - 1))]; };
+
+	double frameBytes = static_cast<double>(boidCount) / delivered * 20.0;   // x, y, dx, dy, rgba
+	std::printf("frames    %llu delivered (%.1f/s), %llu dropped, %llu torn\n",
+		static_cast<unsigned long long>(delivered), delivered / elapsed,
+		static_cast<unsigned long long>(dropped), static_cast<unsigned long long>(torn));
+	std::printf("boids     %.0f per frame, %.1f MB/frame, %.0f MB/s consumed\n",
+		static_cast<double>(boidCount) / delivered, frameBytes / 1e6, frameBytes * delivered / elapsed / 1e6);
+	std::printf("read      %.3f ms mean per frame\n", readMs / (delivered + torn));
+	std::printf("latency   p50 %.0f us, p99 %.0f us, max %.0f us (publish to read)\n",
+		percentile(0.5), percentile(0.99), latencyUs.back());
+	std::printf("last      centroid %.4f %.4f, heading %.4f %.4f, red %.1f\n", lastSummary.centroid.x, lastSummary.centroid.y,
+		lastSummary.heading.x, lastSummary.heading.y, lastSummary.red);
+	return 0;
+}
+
+int main(int argc, char** argv) {
+
+	FeedOptions opt;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--name" && hasValue) opt.name = argv[++i];
+		else if (arg == "--serve" && hasValue) opt.serve = std::atoi(argv[++i]);
+		else if (arg == "--rate" && hasValue) opt.rate = std::max(1.0f, static_cast<float>(std::atof(argv[++i])));
+		else if (arg == "--seconds" && hasValue) opt.seconds = static_cast<float>(std::atof(argv[++i]));
+		else if (arg == "--slots" && hasValue) opt.slots = std::max(2, std::atoi(argv[++i]));
+		else {
+			std::printf("usage: BoidsFeedReader [--name /boids_feed] [--seconds S] [--serve N [--rate HZ] [--slots K]]\n");
+			return 2;
+		}
+	}
+
+	return opt.serve > 0 ? serve(opt) : read(opt);
+}
@@ -0,0 +1,163 @@
+// Multi-rate integration benchmark: step time against accuracy for each maximum rate level.
+// Built with -DBOIDS_BUILD_BENCHMARK=ON. Level 0 is the regular every-step update.
+// Speed is measured on its own seeded run, accuracy by running a multi-rate flock in lockstep
+// with a full-rate reference that is copied over it every `horizon` steps.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "Simulation.h"
+
+struct MultiRateOptions {
+	int      boids   = 10000;
+	int      warmup  = 300;
+	int      steps   = 300;
+	int      horizon = 16;
+	int      syncs   = 10;
+	int      maxLevel = 3;
+	unsigned seed    = 42;
+	float    dt      = 0.016f;
+	float    aspect  = 1400.0f / 900.0f;
+};
+
+struct LevelResult {
+	double stepMs;
+	double dueFraction;
+	double meanError;    // mean position error after `horizon` steps
+	double maxError;
+	double headingError; // mean heading difference (radians) after `horizon` steps
+	double polarization;
+};
+
+static float polarization(const std::vector<Boid>& boids) {
+	glm::vec2 sum(0.0f);
+	for (const Boid& b : boids) sum += glm::normalize(b.dir);
+	return glm::length(sum) / std::max<size_t>(1, boids.size());
+}
+
+static double wrappedDistance(glm::vec2 a, glm::vec2 b, float aspect) {
+	// Boids wrap 0.1 past the edges, one that wrapped in only one of the runs is still close by
+	float width = 2.0f * (aspect + 0.1f), height = 2.2f;
+	float dx = std::abs(a.x - b.x), dy = std::abs(a.y - b.y);
+	dx = std::min(dx, width - dx);
+	dy = std::min(dy, height - dy);
+	return std::sqrt(static_cast<double>(dx * dx + dy * dy));
+}
+
+static void configure(Simulation& sim, int level) {
+	sim.multiRate = level > 0;
+	sim.maxRateLevel = level;
+}
+
+static void syncFrom(Simulation& test, const Simulation& reference) {
+	// Take over the reference state but keep the multi-rate levels the test flock has built up
+	for (size_t i = 0; i < test.Boids.size(); i++) {
+		test.Boids[i].pos = reference.Boids[i].pos;
+		test.Boids[i].dir = reference.Boids[i].dir;
+		test.Boids[i].color = reference.Boids[i].color;
+	}
+	test.frameCount = reference.frameCount;
+}
+
+static LevelResult measure(int level, const MultiRateOptions& opt) {
+
+	LevelResult result{};
+
+	// Speed, with every thread OpenMP offers
+	{
+		Simulation sim(opt.boids, opt.aspect, opt.seed);
+		configure(sim, level);
+		for (int i = 0; i < opt.warmup; i++) sim.update(opt.dt);
+
+		long long due = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < opt.steps; i++) {
+			sim.update(opt.dt);
+			due += level > 0 ? sim.dueCount : static_cast<long long>(sim.Boids.size());
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		result.stepMs = std::chrono::duration<double, std::milli>(end - start).count() / opt.steps;
+		result.dueFraction = static_cast<double>(due) / opt.steps / std::max<size_t>(1, sim.Boids.size());
+		result.polarization = polarization(sim.Boids);
+	}
+
+	// Accuracy, single threaded so the reference itself is deterministic
+	int threads = omp_get_max_threads();
+	omp_set_num_threads(1);
+
+	Simulation reference(opt.boids, opt.aspect, opt.seed);
+	Simulation test(opt.boids, opt.aspect, opt.seed);
+	configure(test, level);
+
+	for (int i = 0; i < opt.warmup; i++) {
+		reference.update(opt.dt);
+		test.update(opt.dt);
+		if ((i + 1) % opt.horizon == 0) syncFrom(test, reference);
+	}
+	syncFrom(test, reference);
+
+	double errorSum = 0.0, headingSum = 0.0;
+	long long samples = 0;
+	for (int s = 0; s < opt.syncs; s++) {
+		for (int i = 0; i < opt.horizon; i++) {
+			reference.update(opt.dt);
+			test.update(opt.dt);
+		}
+
+		for (size_t i = 0; i < reference.Boids.size(); i++) {
+			double error = wrappedDistance(test.Boids[i].pos, reference.Boids[i].pos, opt.aspect);
+			float cosine = glm::dot(glm::normalize(test.Boids[i].dir), glm::normalize(reference.Boids[i].dir));
+			errorSum += error;
+			headingSum += std::acos(std::min(std::max(cosine, -1.0f), 1.0f));
+			result.maxError = std::max(result.maxError, error);
+			samples++;
+		}
+		syncFrom(test, reference);
+	}
+
+	omp_set_num_threads(threads);
+	result.meanError = errorSum / std::max<long long>(1, samples);
+	result.headingError = headingSum / std::max<long long>(1, samples);
+	return result;
+}
+
+int main(int argc, char** argv) {
+
+	MultiRateOptions opt;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--boids" && hasValue) opt.boids = std::atoi(argv[++i]);
+		else if (arg == "--warmup" && hasValue) opt.warmup = std::atoi(argv[++i]);
+		else if (arg == "--steps" && hasValue) opt.steps = std::atoi(argv[++i]);
+		else if (arg == "--horizon" && hasValue) opt.horizon = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--syncs" && hasValue) opt.syncs = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--max-level" && hasValue) opt.maxLevel = std::atoi(argv[++i]);
+		else if (arg == "--seed" && hasValue) opt.seed = static_cast<unsigned>(std::atoi(argv[++i]));
+		else {
+			std::printf("usage: BoidsMultiRate [--boids N] [--warmup N] [--steps N] [--horizon N] [--syncs N] [--max-level L] [--seed S]\n");
+			return 2;
+		}
+	}
+
+	std::printf("boids %d, threads %d, %d timed steps, error after %d steps over %d syncs\n",
+		opt.boids, omp_get_max_threads(), opt.steps, opt.horizon, opt.syncs);
+	std::printf("%6s %10s %8s %9s %12s %11s %13s %13s\n",
+		"level", "ms/step", "speedup", "evaluated", "mean error", "max error", "heading err", "polarization");
+
+	double baseline = 0.0;
+	for (int level = 0; level <= opt.maxLevel; level++) {
+		LevelResult r = measure(level, opt);
+		if (level == 0) baseline = r.stepMs;
+
+		// Errors are in world units, a boid at maxSpeed covers maxSpeed * dt * horizon in that time
+		std::printf("%6d %10.3f %8.2f %8.1f%% %12.5f %11.4f %12.4f %13.3f\n",
+			level, r.stepMs, baseline / r.stepMs, 100.0 * r.dueFraction, r.meanError, r.maxError,
+			r.headingError, r.polarization);
+	}
+	return 0;
+}
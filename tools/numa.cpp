@@ -0,0 +1,203 @@
+// NUMA scaling report, built with -DBOIDS_BUILD_BENCHMARK=ON.
+// Runs the same flock for 1, 2, 4... threads twice: as before, with every page first touched by
+// the main thread and dynamic friend scheduling, and with the NUMA-local mode (first touch by the
+// static blocks, boids sorted by cell, banded grid, pinned threads). For each run it prints the
+// step time, the modeled traffic of a step per second, the bandwidth of a STREAM-style read of the
+// boid array as placed, and the share of boid pages that sit on the node of the thread that updates them. On a single-node machine both placements are local and
+// only the effect of the sorting shows.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Simulation.h"
+#include "Numa.h"
+
+struct NumaOptions {
+	int         boids      = 200000;
+	int         warmup     = 60;
+	int         steps      = 120;
+	int         maxThreads = 0;           // 0 = omp_get_max_threads()
+	float       radius     = 0.0f;        // 0 keeps the default
+	std::string pinning    = "compact";
+	float       dt         = 0.016f;
+};
+
+struct NumaResult {
+	double stepMs     = 0.0;
+	double modeledGBs = 0.0;   // stepBytes() over the step time, a model, not a measurement
+	double streamGBs  = 0.0;   // measured read bandwidth over the boid array
+	double localPages = 0.0;   // share of the boid pages on the node of their thread, -1 = unknown
+	double strays     = 0.0;   // share of boids outside their band in the banded grid build
+};
+
+// Bytes a step moves, counted in cache lines: the grid build and the friend search read every boid,
+// the search reads each candidate in the 3x3 cells once and writes a pointer per friend, and the
+// update reads and writes the boid and reads each friend.
+static double stepBytes(const Simulation& sim) {
+	const double line = 64.0;
+	double boidLines = std::ceil(sizeof(Boid) / line);
+	double candidates = 0.0, friends = 0.0;
+	for (const Boid& b : sim.Boids) {
+		candidates += sim.grid.count_nearby(sim.grid.getCell(b.pos.x, b.pos.y));
+		friends += b.friends.size() + b.predators.size();
+	}
+	double n = static_cast<double>(sim.Boids.size());
+	return n * (line + sizeof(int))            // grid build
+		+ n * line + candidates * line + friends * sizeof(Boid*)   // friend search
+		+ n * boidLines * line * 2.0 + friends * line;             // update
+}
+
+// Best of a few parallel read passes over the boid array (a STREAM-style sum), with the threads
+// and static blocks of the update, so it sees the pages where this run's placement put them
+static volatile uint64_t streamSink;   // keeps the sums of the read passes alive
+
+static double streamRead(const Simulation& sim, int threads) {
+	const char* base = reinterpret_cast<const char*>(sim.Boids.data());
+	long long words = static_cast<long long>(sim.Boids.size() * sizeof(Boid) / sizeof(uint64_t));
+	if (words == 0) return 0.0;
+
+	double best = 0.0;
+	for (int rep = 0; rep < 5; rep++) {
+		uint64_t sum = 0;
+		auto start = std::chrono::steady_clock::now();
+		#pragma omp parallel for schedule(static) num_threads(threads) reduction(+:sum)
+		for (long long w = 0; w < words; w++) {
+			uint64_t word;
+			std::memcpy(&word, base + w * sizeof(uint64_t), sizeof(word));
+			sum += word;
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		streamSink = streamSink + sum;
+		best = std::max(best, words * sizeof(uint64_t) / (seconds * 1e9));
+	}
+	return best;
+}
+
+static double localShare(const Simulation& sim, int threads) {
+
+	// Node each thread runs on right now, pinned threads stay there
+	std::vector<int> threadNode(threads, 0);
+	#pragma omp parallel num_threads(threads)
+	threadNode[omp_get_thread_num()] = numa::cpuNode(numa::currentCpu());
+
+	const char* base = reinterpret_cast<const char*>(sim.Boids.data());
+	size_t bytes = sim.Boids.size() * sizeof(Boid);
+	std::vector<int> nodes = numa::pageNodes(base, bytes);
+	uintptr_t firstPage = reinterpret_cast<uintptr_t>(base) & ~static_cast<uintptr_t>(4095);
+	int numBoids = static_cast<int>(sim.Boids.size());
+
+	size_t known = 0, local = 0;
+	for (size_t p = 0; p < nodes.size(); p++) {
+		if (nodes[p] < 0) continue;
+		uintptr_t address = std::max(firstPage + p * 4096, reinterpret_cast<uintptr_t>(base));
+		int index = static_cast<int>((address - reinterpret_cast<uintptr_t>(base)) / sizeof(Boid));
+		int owner = 0;
+		while (owner + 1 < threads && numa::staticBlock(numBoids, threads, owner).end <= index) owner++;
+		known++;
+		if (nodes[p] == threadNode[owner]) local++;
+	}
+	return known ? static_cast<double>(local) / known : -1.0;
+}
+
+static NumaResult run(const NumaOptions& opt, int threads, bool numaLocal) {
+
+	// Before: the flock is created on one thread, so the main thread touches every page first
+	omp_set_num_threads(numaLocal ? threads : 1);
+	Simulation sim;
+	sim.aspect = 1400.0f / 900.0f;
+	sim.seed = 1;
+	sim.setupSimulation(opt.boids);
+	if (opt.radius > 0.0f) sim.fovRadius = opt.radius;
+	sim.numaLocal = numaLocal;
+	if (numaLocal) sim.pinning = opt.pinning;
+	omp_set_num_threads(threads);
+
+	for (int i = 0; i < opt.warmup; i++) sim.update(opt.dt);
+
+	NumaResult result;
+	double strays = 0.0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < opt.steps; i++) {
+		sim.update(opt.dt);
+		if (numaLocal) strays += sim.grid.strayCount();
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	result.stepMs = std::chrono::duration<double, std::milli>(end - start).count() / opt.steps;
+	result.modeledGBs = stepBytes(sim) / (result.stepMs * 1e6);
+	result.streamGBs = streamRead(sim, threads);
+	result.localPages = localShare(sim, threads);
+	result.strays = strays / opt.steps / std::max<size_t>(sim.Boids.size(), 1);
+	return result;
+}
+
+static void printUsage() {
+	std::printf(
+		"usage: BoidsNuma [options]\n"
+		"  --boids N        population (default 200000)\n"
+		"  --warmup N       steps before measuring (default 60)\n"
+		"  --steps N        measured steps (default 120)\n"
+		"  --threads N      largest thread count (default: all)\n"
+		"  --radius R       fov radius\n"
+		"  --pin SPEC       compact, spread or a cpu list (default compact)\n");
+}
+
+int main(int argc, char** argv) {
+
+	NumaOptions opt;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--boids" && hasValue) opt.boids = std::atoi(argv[++i]);
+		else if (arg == "--warmup" && hasValue) opt.warmup = std::atoi(argv[++i]);
+		else if (arg == "--steps" && hasValue) opt.steps = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--threads" && hasValue) opt.maxThreads = std::atoi(argv[++i]);
+		else if (arg == "--radius" && hasValue) opt.radius = static_cast<float>(std::atof(argv[++i]));
+		else if (arg == "--pin" && hasValue) opt.pinning = argv[++i];
+		else {
+			printUsage();
+			return 2;
+		}
+	}
+	if (numa::pinOrder(opt.pinning).empty()) {
+		std::printf("invalid pinning %s\n", opt.pinning.c_str());
+		return 2;
+	}
+
+	int maxThreads = opt.maxThreads > 0 ? opt.maxThreads : omp_get_max_threads();
+	std::vector<int> counts;
+	for (int t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+	counts.push_back(maxThreads);
+
+	// All unpinned runs first, threads created after pinning inherit the main thread's affinity
+	std::vector<NumaResult> before, after;
+	for (int t : counts) before.push_back(run(opt, t, false));
+	for (int t : counts) after.push_back(run(opt, t, true));
+
+	std::printf("boids %d, %d NUMA nodes, pinning %s, %.1f MB of boids\n", opt.boids, numa::nodeCount(),
+		opt.pinning.c_str(), opt.boids * sizeof(Boid) / 1e6);
+	std::printf("modeled GB/s: traffic counted by stepBytes() over the step time, stream GB/s: measured read of the boid array\n");
+	std::printf("%8s | %10s %8s %8s %7s | %10s %8s %8s %7s %7s | %7s\n", "threads",
+		"before ms", "modeled", "stream", "local", "after ms", "modeled", "stream", "local", "strays", "speedup");
+
+	auto percent = [](double share, char* text) {
+		if (share < 0.0) std::snprintf(text, 16, "%7s", "n/a");
+		else std::snprintf(text, 16, "%6.1f%%", share * 100.0);
+	};
+	for (size_t k = 0; k < counts.size(); k++) {
+		char localBefore[16], localAfter[16], strays[16];
+		percent(before[k].localPages, localBefore);
+		percent(after[k].localPages, localAfter);
+		percent(after[k].strays, strays);
+		std::printf("%8d | %10.2f %8.2f %8.2f %s | %10.2f %8.2f %8.2f %s %s | %6.2fx\n", counts[k],
+			before[k].stepMs, before[k].modeledGBs, before[k].streamGBs, localBefore,
+			after[k].stepMs, after[k].modeledGBs, after[k].streamGBs, localAfter, strays,
+			before[k].stepMs / after[k].stepMs);
+	}
+	return 0;
+}
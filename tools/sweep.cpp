@@ -0,0 +1,284 @@
+// Parallel parameter sweep / ensemble runner.
+// Reads a sweep file of `key = value, value, ...` lines, runs the cartesian product of all
+// listed values as independent headless Simulations and writes one CSV row of summary metrics
+// per run. Small runs are packed one per core, big ones get several OpenMP threads each.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Simulation.h"
+
+struct SweepOptions {
+	std::string config;
+	std::string out       = "sweep.csv";
+	int         threads   = 0;   // total budget, 0 = all cores
+	int         perRun    = 0;   // OpenMP threads per run, 0 = derive from the budget
+};
+
+// Every parameter is a list, the sweep is their cartesian product
+struct SweepSpec {
+	std::vector<float> boids      = { 1000 };
+	std::vector<float> steps      = { 500 };
+	std::vector<float> seeds      = { 1 };
+	std::vector<float> dt         = { 0.016f };
+	std::vector<float> alignment  = { 2.0f };
+	std::vector<float> cohesion   = { 3.0f };
+	std::vector<float> separation = { 1.0f };
+	std::vector<float> fovRadius  = { 0.1f };
+	std::vector<float> fov        = { 0.5f };
+	std::vector<float> maxSpeed   = { 0.5f };
+	std::vector<float> minSpeed   = { 0.2f };
+	float              aspect     = 1400.0f / 900.0f;
+};
+
+struct RunParams {
+	int      boids, steps;
+	unsigned seed;
+	float    dt, alignment, cohesion, separation, fovRadius, fov, maxSpeed, minSpeed;
+};
+
+struct RunResult {
+	double polarization;      // |mean heading|, 1 = everybody flies the same way
+	double meanSpeed;
+	double meanFriends;
+	double meanNearest;       // mean distance to the nearest other boid (sampled)
+	double seconds;
+};
+
+static std::vector<float> parseList(const std::string& text) {
+	// "1, 2, 3" or a range "1..32" (inclusive, step 1)
+	std::vector<float> values;
+	size_t dots = text.find("..");
+	if (dots != std::string::npos) {
+		int first = std::atoi(text.substr(0, dots).c_str());
+		int last  = std::atoi(text.substr(dots + 2).c_str());
+		for (int v = first; v <= last; v++) values.push_back(static_cast<float>(v));
+		return values;
+	}
+
+	std::string item;
+	std::stringstream stream(text);
+	while (std::getline(stream, item, ',')) {
+		if (item.find_first_not_of(" \t") == std::string::npos) continue;
+		values.push_back(static_cast<float>(std::atof(item.c_str())));
+	}
+	return values;
+}
+
+static bool loadSpec(const std::string& path, SweepSpec& spec) {
+	std::ifstream file(path);
+	if (!file) {
+		std::fprintf(stderr, "cannot open sweep file %s\n", path.c_str());
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+		size_t eq = line.find('=');
+		if (eq == std::string::npos) {
+			if (line.find_first_not_of(" \t\r") != std::string::npos) {
+				std::fprintf(stderr, "%s:%d: expected key = values\n", path.c_str(), lineNumber);
+				return false;
+			}
+			continue;
+		}
+
+		std::string key = line.substr(0, eq);
+		key.erase(std::remove_if(key.begin(), key.end(), ::isspace), key.end());
+		std::vector<float> values = parseList(line.substr(eq + 1));
+		if (values.empty()) {
+			std::fprintf(stderr, "%s:%d: no values for %s\n", path.c_str(), lineNumber, key.c_str());
+			return false;
+		}
+
+		if (key == "boids") spec.boids = values;
+		else if (key == "steps") spec.steps = values;
+		else if (key == "seeds") spec.seeds = values;
+		else if (key == "dt") spec.dt = values;
+		else if (key == "alignment") spec.alignment = values;
+		else if (key == "cohesion") spec.cohesion = values;
+		else if (key == "separation") spec.separation = values;
+		else if (key == "fovRadius") spec.fovRadius = values;
+		else if (key == "fov") spec.fov = values;
+		else if (key == "maxSpeed") spec.maxSpeed = values;
+		else if (key == "minSpeed") spec.minSpeed = values;
+		else if (key == "aspect") spec.aspect = values[0];
+		else {
+			std::fprintf(stderr, "%s:%d: unknown key %s\n", path.c_str(), lineNumber, key.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+static std::vector<RunParams> expand(const SweepSpec& spec) {
+	std::vector<RunParams> runs;
+	for (float boids : spec.boids)
+	for (float steps : spec.steps)
+	for (float dt : spec.dt)
+	for (float alignment : spec.alignment)
+	for (float cohesion : spec.cohesion)
+	for (float separation : spec.separation)
+	for (float fovRadius : spec.fovRadius)
+	for (float fov : spec.fov)
+	for (float maxSpeed : spec.maxSpeed)
+	for (float minSpeed : spec.minSpeed)
+	for (float seed : spec.seeds) {
+		runs.push_back({ static_cast<int>(boids), static_cast<int>(steps), static_cast<unsigned>(seed),
+			dt, alignment, cohesion, separation, fovRadius, fov, maxSpeed, minSpeed });
+	}
+	return runs;
+}
+
+static RunResult runOne(const RunParams& p, float aspect) {
+
+	auto start = std::chrono::steady_clock::now();
+
+	Simulation sim(static_cast<unsigned>(p.boids), aspect, p.seed);
+	sim.alignment  = p.alignment;
+	sim.cohesion   = p.cohesion;
+	sim.separation = p.separation;
+	sim.fovRadius  = p.fovRadius;
+	sim.fov        = p.fov;
+	sim.maxSpeed   = p.maxSpeed;
+	sim.minSpeed   = p.minSpeed;
+
+	double friends = 0.0;
+	for (int step = 0; step < p.steps; step++) {
+		sim.update(p.dt);
+		if (step == p.steps - 1) {
+			for (const Boid& b : sim.Boids) friends += b.friends.size();
+		}
+	}
+
+	RunResult result{};
+	glm::vec2 heading(0.0f);
+	for (const Boid& b : sim.Boids) {
+		float speed = glm::length(b.dir);
+		result.meanSpeed += speed;
+		if (speed > 0.0f) heading += b.dir / speed;
+	}
+
+	// Nearest neighbour distance over an evenly spaced sample, through this step's grid
+	FlockQuery query = sim.query();
+	std::vector<int> nearest;
+	size_t stride = std::max<size_t>(1, sim.Boids.size() / 256);
+	int samples = 0;
+	for (size_t i = 0; i < sim.Boids.size(); i += stride) {
+		nearest.clear();
+		query.nearest(sim.Boids[i].pos, 2, nearest);
+		if (nearest.size() < 2) continue;
+		int other = nearest[0] == static_cast<int>(i) ? nearest[1] : nearest[0];
+		result.meanNearest += glm::length(sim.Boids[other].pos - sim.Boids[i].pos);
+		samples++;
+	}
+
+	double count = std::max<size_t>(1, sim.Boids.size());
+	result.polarization = glm::length(heading) / count;
+	result.meanSpeed   /= count;
+	result.meanFriends  = 2.0 * friends / count; // each pair is listed once, on the lower id
+	result.meanNearest /= std::max(samples, 1);
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+int main(int argc, char** argv) {
+
+	SweepOptions opt;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--config" && hasValue) opt.config = argv[++i];
+		else if (arg == "--out" && hasValue) opt.out = argv[++i];
+		else if (arg == "--threads" && hasValue) opt.threads = std::atoi(argv[++i]);
+		else if (arg == "--per-run" && hasValue) opt.perRun = std::atoi(argv[++i]);
+		else {
+			std::printf(
+				"usage: BoidsSweep --config sweep.cfg [--out sweep.csv] [--threads T] [--per-run P]\n"
+				"  --threads T   total thread budget (default: all cores)\n"
+				"  --per-run P   OpenMP threads inside each run (default: budget / concurrent runs)\n");
+			return 2;
+		}
+	}
+	if (opt.config.empty()) {
+		std::fprintf(stderr, "missing --config\n");
+		return 2;
+	}
+
+	SweepSpec spec;
+	if (!loadSpec(opt.config, spec)) return 1;
+	std::vector<RunParams> runs = expand(spec);
+	if (runs.empty()) return 0;
+
+	// Thread budget: as many runs side by side as there are threads (best throughput for small
+	// flocks, no synchronisation at all), leftover threads go into the runs themselves
+	int budget = opt.threads > 0 ? opt.threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+	int perRun = opt.perRun > 0 ? opt.perRun : std::max(1, budget / static_cast<int>(std::min<size_t>(runs.size(), budget)));
+	int workers = std::max(1, budget / perRun);
+
+	// Longest runs first so the tail of the sweep isn't one big straggler
+	std::vector<int> order(runs.size());
+	for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<int>(i);
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+		return static_cast<double>(runs[a].boids) * runs[a].steps > static_cast<double>(runs[b].boids) * runs[b].steps;
+	});
+
+	std::vector<RunResult> results(runs.size());
+	std::atomic<size_t> next{ 0 };
+	std::atomic<size_t> done{ 0 };
+	auto start = std::chrono::steady_clock::now();
+
+	auto worker = [&]() {
+		omp_set_num_threads(perRun);   // per thread setting, only affects this worker's runs
+		for (size_t k = next.fetch_add(1); k < order.size(); k = next.fetch_add(1)) {
+			int run = order[k];
+			results[run] = runOne(runs[run], spec.aspect);
+
+			size_t finished = done.fetch_add(1) + 1;
+			if (finished % 100 == 0 || finished == runs.size()) {
+				std::fprintf(stderr, "\r%zu / %zu runs", finished, runs.size());
+			}
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (int w = 1; w < workers; w++) pool.emplace_back(worker);
+	worker();
+	for (std::thread& t : pool) t.join();
+	std::fprintf(stderr, "\n");
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::FILE* csv = std::fopen(opt.out.c_str(), "w");
+	if (!csv) {
+		std::perror(opt.out.c_str());
+		return 1;
+	}
+	std::fprintf(csv, "run,boids,steps,seed,dt,alignment,cohesion,separation,fovRadius,fov,maxSpeed,minSpeed,"
+		"polarization,meanSpeed,meanFriends,meanNearest,seconds\n");
+	for (size_t i = 0; i < runs.size(); i++) {
+		const RunParams& p = runs[i];
+		const RunResult& r = results[i];
+		std::fprintf(csv, "%zu,%d,%d,%u,%g,%g,%g,%g,%g,%g,%g,%g,%.6f,%.6f,%.4f,%.6f,%.4f\n",
+			i, p.boids, p.steps, p.seed, p.dt, p.alignment, p.cohesion, p.separation, p.fovRadius, p.fov,
+			p.maxSpeed, p.minSpeed, r.polarization, r.meanSpeed, r.meanFriends, r.meanNearest, r.seconds);
+	}
+	std::fclose(csv);
+
+	double boidSteps = 0.0;
+	for (const RunParams& p : runs) boidSteps += static_cast<double>(p.boids) * p.steps;
+	std::printf("%zu runs in %.2f s on %d workers x %d threads, %.2f M boid-steps/s -> %s\n",
+		runs.size(), seconds, workers, perRun, boidSteps / seconds / 1e6, opt.out.c_str());
+	return 0;
+}